@@ -0,0 +1,83 @@
+// microbenchmark: random access tile reads through Area::tiles (ChunkGrid)
+// against the previous unordered_map<ivec3, Chunk*> lookup path
+#include "bench.hpp"
+#include "level/area.hpp"
+#include "level/gen.hpp"
+
+static constexpr usize NUM_READS = 1 << 22;
+
+template <typename F>
+static void run(const std::string &name, F f) {
+    const auto start = bench::now();
+    const u64 sum = f();
+    const auto elapsed = bench::now() - start;
+
+    util::log::out()
+        << name << ": "
+        << std::fixed << std::setprecision(2)
+        << (elapsed / static_cast<f64>(NUM_READS)) << " ns/read"
+        << " (checksum " << sum << ")"
+        << util::log::end;
+}
+
+int main(UNUSED int argc, UNUSED char *argv[]) {
+    bench::init();
+    state.jobs.start();
+
+    auto area = level::Area(level::gen);
+    area.center = glm::ivec3(0);
+
+    bench::generate(area);
+    const usize diameter = (area.radius * 2) + 1;
+
+    // the old Area::chunks, with the old lookup path
+    std::unordered_map<glm::ivec3, level::Chunk*> map;
+    for (auto *chunk : area.chunks) {
+        map[chunk->offset] = chunk;
+    }
+
+    const auto old_read = [&](const glm::ivec3 &pos) -> level::TileId {
+        const glm::ivec3 offset =
+            glm::floor(glm::vec3(pos) / glm::vec3(level::Chunk::SIZE));
+        return map.contains(offset) ?
+            map[offset]->tiles.safe(level::Area::to_chunk_pos(pos))
+            : level::Chunk::TileData::ZERO;
+    };
+
+    // random positions, ~1/16 outside of the loaded area
+    auto rand = util::rand(0x4EAD);
+    const auto extent =
+        static_cast<int>(
+            (area.radius + 1) * level::Chunk::SIZE.x);
+
+    std::vector<glm::ivec3> positions(NUM_READS);
+    for (auto &p : positions) {
+        p = glm::ivec3(
+            rand.next<int>(-extent, extent - 1),
+            rand.next<int>(0, level::Chunk::SIZE.y - 1),
+            rand.next<int>(-extent, extent - 1));
+    }
+
+    util::log::out()
+        << diameter << "x" << diameter << " chunks, "
+        << NUM_READS << " random reads"
+        << util::log::end;
+
+    run("unordered_map", [&]() {
+        u64 sum = 0;
+        for (const auto &p : positions) {
+            sum += old_read(p);
+        }
+        return sum;
+    });
+
+    run("ChunkGrid", [&]() {
+        u64 sum = 0;
+        for (const auto &p : positions) {
+            sum += static_cast<level::TileId>(area.tiles[p]);
+        }
+        return sum;
+    });
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#ifndef BENCH_BENCH_HPP
+#define BENCH_BENCH_HPP
+
+// shared by every benchmark, included once by each bench/<name>.cpp (which is
+// its own program) so that it also defines the global state
+// define BENCH_COUNT_ALLOCATIONS before including it to count heap
+// allocations made through operator new (see bench::allocations)
+#include "util/util.hpp"
+#include "level/area.hpp"
+#include "state.hpp"
+
+// global state, referenced from state.hpp
+static State global_state;
+State &state = global_state;
+
+namespace bench {
+// nanoseconds on the high resolution clock
+static inline u64 now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now()
+            .time_since_epoch()).count();
+}
+
+// logs to stdout/stderr, first thing in main
+static inline void init() {
+    state.platform.log_out = &std::cout;
+    state.platform.log_err = &std::cerr;
+}
+
+// argv[i] as a number (at least min), fallback if it was not passed
+static inline usize arg(
+    int argc, char *argv[], int i, usize fallback, int min = 1) {
+    return argc > i ?
+        static_cast<usize>(std::max(std::atoi(argv[i]), min))
+        : fallback;
+}
+
+// ticks area until every chunk within its radius of center is loaded,
+// generation on the main thread is not throttled
+static inline void generate(level::Area &area) {
+    state.throttles.gen_max = std::numeric_limits<usize>::max();
+
+    const usize diameter = (area.radius * 2) + 1;
+    while (area.chunks.size() < diameter * diameter) {
+        state.throttles.gen = 0;
+        area.tick();
+
+        // let job workers generate
+        if (state.jobs.size() > 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// meshes all of chunk's sections into build with mesher
+static inline void mesh(
+    level::Chunk &chunk,
+    level::ChunkRenderer::Build &build,
+    level::ChunkRenderer::Mesher mesher = level::ChunkRenderer::PER_FACE) {
+    chunk.snapshot(build.snapshot);
+    build.mesher = mesher;
+    build.dirty.fill(true);
+    level::ChunkRenderer::mesh(build);
+}
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+// bytes/number of allocations made through operator new, which does not see
+// std::malloc/std::aligned_alloc (e.g. util::Pool slabs)
+static std::atomic<usize> allocated_bytes = 0, allocations = 0;
+#endif
+}
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+void *operator new(std::size_t n) {
+    bench::allocated_bytes += n;
+    bench::allocations++;
+
+    if (void *p = std::malloc(n ? n : 1)) {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, UNUSED std::size_t n) noexcept {
+    std::free(p);
+}
+#endif
+
+#endif
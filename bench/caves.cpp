@@ -0,0 +1,181 @@
+// cave culling: generates an area, carves tunnels through it (some of them
+// opening onto the surface as overhangs), meshes it and counts the section
+// draws a perspective camera would submit with frustum culling alone and
+// with cave culling (level::visible_sections), from above ground and from
+// inside a tunnel, looking in 4 directions each
+// usage: bench-caves [N = 13]
+#include "bench.hpp"
+#include "level/area.hpp"
+#include "level/gen.hpp"
+
+using Builds =
+    std::unordered_map<
+        glm::ivec3, std::unique_ptr<level::ChunkRenderer::Build>>;
+
+// carves a tunnel of spheres along a random walk from start, returns a point
+// halfway along it
+static glm::ivec3 tunnel(
+    level::Area &area, util::Rand &rand, glm::vec3 pos, usize length) {
+    glm::ivec3 middle;
+    auto dir = glm::normalize(glm::vec3(rand.gaussian(), 0, rand.gaussian()));
+
+    for (usize i = 0; i < length; i++) {
+        const int r = rand.next<int>(2, 3);
+
+        for (int x = -r; x <= r; x++) {
+            for (int y = -r; y <= r; y++) {
+                for (int z = -r; z <= r; z++) {
+                    const auto p = glm::ivec3(pos) + glm::ivec3(x, y, z);
+                    auto *chunk = area.chunkp(level::Area::to_offset(p));
+
+                    if (p.y > 0
+                            && p.y < level::Chunk::SIZE.y
+                            && chunk
+                            && glm::length2(glm::vec3(x, y, z)) <= r * r) {
+                        chunk->tiles[level::Area::to_chunk_pos(p)] = 0;
+                    }
+                }
+            }
+        }
+
+        if (i == length / 2) {
+            middle = glm::ivec3(pos);
+        }
+
+        // wander, mostly horizontally
+        dir =
+            glm::normalize(
+                dir + glm::vec3(
+                    rand.gaussian() * 0.3,
+                    rand.gaussian() * 0.1,
+                    rand.gaussian() * 0.3));
+        pos += dir * 1.5f;
+    }
+
+    return middle;
+}
+
+int main(int argc, char *argv[]) {
+    bench::init();
+
+    const usize n = bench::arg(argc, argv, 1, 13);
+
+    auto area = level::Area(level::gen);
+    area.radius = n / 2;
+    area.center = glm::ivec3(0);
+    bench::generate(area);
+
+    // tunnels starting underground and at the surface
+    const int extent = (area.radius * level::Chunk::SIZE.x);
+    auto rand = util::rand(0xCA7E);
+    glm::ivec3 cave;
+
+    for (usize i = 0; i < 32; i++) {
+        const auto xz =
+            glm::ivec2(
+                rand.next<int>(-extent, extent),
+                rand.next<int>(-extent, extent));
+        const int surface = area.height(level::Chunk::Heightmap::SOLID, xz);
+        const int depth = i % 4 == 0 ? 0 : rand.next<int>(8, 40);
+
+        const auto middle =
+            tunnel(
+                area, rand,
+                glm::vec3(xz.x, std::max(surface - depth, 4), xz.y),
+                80);
+
+        if (i == 1) {
+            cave = middle;
+        }
+    }
+
+    Builds builds;
+    for (auto *chunk : area.chunks) {
+        bench::mesh(
+            *chunk,
+            *(builds[chunk->offset] =
+                std::make_unique<level::ChunkRenderer::Build>()));
+    }
+
+    const auto surface =
+        glm::vec3(
+            0.5f,
+            area.height(level::Chunk::Heightmap::SOLID, glm::ivec2(0)) + 2.0f,
+            0.5f);
+
+    const std::vector<std::tuple<std::string, glm::vec3, f32>> views = {
+        { "surface", surface, 0.0f },
+        { "surface, looking down", surface, -0.6f },
+        { "tunnel", glm::vec3(cave) + 0.5f, 0.0f }
+    };
+
+    std::vector<level::SectionNode> queue;
+    std::unordered_set<glm::ivec3> visited;
+
+    for (const auto &[name, position, pitch] : views) {
+        usize frustum_only = 0, cave_culled = 0;
+
+        for (usize i = 0; i < 4; i++) {
+            auto camera =
+                util::PerspectiveCamera(
+                    glm::radians(75.0f), 16.0f / 9.0f,
+                    glm::vec2(0.08f, 128.0f),
+                    position);
+            camera.pitch = pitch;
+            camera.yaw = i * (glm::pi<f32>() / 2.0f);
+            camera.update();
+
+            const auto frustum = camera.frustum();
+
+            // non-empty sections in the frustum
+            for (const auto &[offset, build] : builds) {
+                for (usize s = 0; s < level::Chunk::SECTIONS; s++) {
+                    const auto min =
+                        glm::vec3(
+                            (offset * level::Chunk::SIZE)
+                                + glm::ivec3(0, s * 16, 0));
+                    frustum_only +=
+                        build->sections[s].num_quads() > 0
+                        && frustum.contains(
+                            util::AABB(
+                                min,
+                                min + glm::vec3(
+                                    level::Chunk::SECTION_SIZE)));
+                }
+            }
+
+            visited.clear();
+            level::visible_sections(
+                position, frustum,
+                [&](const glm::ivec3 &offset, usize s)
+                    -> const level::SectionVisibility* {
+                    const auto it = builds.find(offset);
+                    return it == builds.end() ?
+                        nullptr : &it->second->sections[s].visibility;
+                },
+                [&](const glm::ivec3 &offset, usize s) {
+                    if (!visited.insert(offset + glm::ivec3(0, s, 0))
+                            .second) {
+                        return false;
+                    }
+
+                    cave_culled +=
+                        builds[offset]->sections[s].num_quads() > 0;
+                    return true;
+                },
+                queue);
+        }
+
+        util::log::out()
+            << name << ": "
+            << frustum_only << " section draws with frustum culling, "
+            << cave_culled << " with cave culling ("
+            << std::fixed << std::setprecision(1)
+            << (100.0 * (frustum_only - cave_culled)
+                / std::max<usize>(frustum_only, 1))
+            << "% saved)"
+            << util::log::end;
+    }
+
+    return 0;
+}
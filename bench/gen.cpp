@@ -0,0 +1,99 @@
+// headless worldgen benchmark: generates an N x N chunk square through
+// Area::tick with level::gen, reports chunks/second, p50/p99 time per chunk,
+// bytes allocated (through operator new and as chunk slabs) and a world
+// checksum to compare optimizations against
+// usage: bench-gen [N = 21] [job workers = 0, generates on the main thread]
+#define BENCH_COUNT_ALLOCATIONS
+#include "bench.hpp"
+#include "level/area.hpp"
+#include "level/gen.hpp"
+
+int main(int argc, char *argv[]) {
+    bench::init();
+
+    // square is (radius * 2) + 1 on each side, so round N up to odd
+    const usize
+        n = bench::arg(argc, argv, 1, 21),
+        workers = bench::arg(argc, argv, 2, 0, 0),
+        radius = n / 2,
+        diameter = (radius * 2) + 1;
+
+    if (workers > 0) {
+        state.jobs.start(workers);
+    }
+
+    // time of each generator call, which may be on any worker
+    std::mutex times_mutex;
+    std::vector<u64> times;
+
+    auto area = level::Area([&](level::Chunk &chunk) {
+        const auto start = bench::now();
+        level::gen(chunk);
+        const auto elapsed = bench::now() - start;
+
+        std::lock_guard lock(times_mutex);
+        times.push_back(elapsed);
+    });
+
+    area.radius = radius;
+    area.center = glm::ivec3(0);
+    area.gen_threads = workers;
+    area.gen_integrate_max = std::numeric_limits<usize>::max();
+
+    // chunk slabs come from std::aligned_alloc, which operator new does not
+    // see, and are counted from the pool's stats instead
+    const auto &pool = area.chunk_pool.stats;
+    const usize
+        bytes_start = bench::allocated_bytes + pool.slab_bytes,
+        allocations_start = bench::allocations + pool.slabs;
+    const auto start = bench::now();
+
+    bench::generate(area);
+
+    const auto elapsed = bench::now() - start;
+    const usize
+        bytes = bench::allocated_bytes + pool.slab_bytes - bytes_start,
+        count = bench::allocations + pool.slabs - allocations_start,
+        chunks = area.chunks.size();
+
+    std::sort(times.begin(), times.end());
+    const auto percentile = [&](f64 p) {
+        return util::Time::to_millis<f64>(
+            times[std::min<usize>(times.size() * p, times.size() - 1)]);
+    };
+
+    util::log::out()
+        << diameter << "x" << diameter << " chunks, "
+        << state.jobs.size() << " workers"
+        << util::log::end;
+
+    util::log::out()
+        << std::fixed << std::setprecision(2)
+        << (chunks / util::Time::to_seconds<f64>(elapsed)) << " chunks/s, "
+        << std::setprecision(3)
+        << "p50 " << percentile(0.50) << " ms, "
+        << "p99 " << percentile(0.99) << " ms per chunk"
+        << util::log::end;
+
+    util::log::out()
+        << "allocated: " << (bytes / 1024) << " KiB in "
+        << count << " allocations ("
+        << (bytes / chunks) << " B/chunk, including "
+        << pool.slabs << " chunk slabs of "
+        << (pool.slab_bytes / 1024) << " KiB), storage: "
+        << (area.bytes() / 1024) << " KiB"
+        << util::log::end;
+
+    const auto &cache = level::gen_cache();
+    util::log::out()
+        << "gen cache: "
+        << std::fixed << std::setprecision(1)
+        << (cache.hit_rate() * 100.0) << "% hits"
+        << util::log::end;
+
+    util::log::out()
+        << "checksum: " << std::hex << area.checksum() << std::dec
+        << util::log::end;
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+// generation determinism: generates the same area through Area::tick, in
+// shuffled orders and on the job system with different numbers of workers,
+// and compares every chunk's checksum against the first run
+// exits with 1 if any chunk differs
+#include "bench.hpp"
+#include "level/area.hpp"
+#include "level/gen.hpp"
+
+using Checksums = std::unordered_map<glm::ivec3, u64>;
+
+// logs and counts chunks which differ from expected
+static usize compare(
+    const std::string &name,
+    const Checksums &expected,
+    const Checksums &actual) {
+    usize n = 0;
+    for (const auto &[offset, sum] : expected) {
+        const auto it = actual.find(offset);
+        if (it == actual.end() || it->second != sum) {
+            n++;
+        }
+    }
+
+    util::log::out()
+        << name << ": " << actual.size() << " chunks, "
+        << n << " mismatches"
+        << util::log::end;
+    return n;
+}
+
+// generates each offset into a detached chunk, in order, on jobs if it has
+// workers
+static Checksums generate(
+    level::Area &area, const std::vector<glm::ivec3> &offsets) {
+    std::vector<util::Pool<level::Chunk>::Ptr> chunks;
+    for (const auto &offset : offsets) {
+        chunks.push_back(area.chunk_pool.make(area, offset));
+    }
+
+    state.jobs.wait(
+        state.jobs.parallel_for(
+            0, chunks.size(), 1,
+            [&](usize i) { level::gen(*chunks[i]); }));
+
+    Checksums result;
+    for (const auto &chunk : chunks) {
+        result[chunk->offset] = chunk->checksum();
+    }
+    return result;
+}
+
+int main(UNUSED int argc, UNUSED char *argv[]) {
+    bench::init();
+
+    // reference: synchronous, nearest first through Area::tick
+    auto area = level::Area(level::gen);
+    area.center = glm::ivec3(0);
+
+    bench::generate(area);
+    const usize diameter = (area.radius * 2) + 1;
+
+    Checksums expected;
+    std::vector<glm::ivec3> offsets;
+    for (auto *chunk : area.chunks) {
+        expected[chunk->offset] = chunk->checksum();
+        offsets.push_back(chunk->offset);
+    }
+
+    util::log::out()
+        << diameter << "x" << diameter << " chunks, checksum "
+        << std::hex << area.checksum() << std::dec
+        << util::log::end;
+
+    usize mismatches = 0;
+
+    // different orders, each with a cold noise cache
+    auto reversed = offsets;
+    std::reverse(reversed.begin(), reversed.end());
+
+    auto shuffled = offsets;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937_64(0x6E4));
+
+    level::gen_cache().clear();
+    mismatches += compare("reversed", expected, generate(area, reversed));
+
+    level::gen_cache().clear();
+    mismatches += compare("shuffled", expected, generate(area, shuffled));
+
+    // different numbers of workers, shuffled
+    for (const usize n : { 1, 2, 4, 0 }) {
+        state.jobs.start(n);
+        level::gen_cache().clear();
+
+        mismatches +=
+            compare(
+                std::to_string(state.jobs.size()) + " workers",
+                expected,
+                generate(area, shuffled));
+
+        state.jobs.stop();
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
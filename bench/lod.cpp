@@ -0,0 +1,123 @@
+// level of detail: generates an area with its rings of downsampled chunks,
+// meshes every chunk of every level and reports, per level, chunks, storage,
+// generation time and quads against what the same columns would cost at
+// full resolution (extrapolated from the area's own chunks)
+// usage: bench-lod [N = 9] [levels = 3]
+#include "bench.hpp"
+#include "level/area.hpp"
+#include "level/gen.hpp"
+
+int main(int argc, char *argv[]) {
+    bench::init();
+
+    const usize
+        n = bench::arg(argc, argv, 1, 9),
+        levels =
+            std::min<usize>(
+                bench::arg(argc, argv, 2, 3, 0),
+                level::Area::LOD_LEVELS);
+
+    // generation time and chunks generated by level, everything is
+    // generated on this thread, including inner chunks which are dropped
+    // once the level below is loaded
+    std::array<u64, level::Area::LOD_LEVELS + 1> gen_ns = {};
+    std::array<usize, level::Area::LOD_LEVELS + 1> gen_chunks = {};
+    const auto timed = [&](auto f) {
+        return [&gen_ns, &gen_chunks, f](level::Chunk &chunk) {
+            const auto start = bench::now();
+            f(chunk);
+            gen_ns[chunk.lod] += bench::now() - start;
+            gen_chunks[chunk.lod]++;
+        };
+    };
+
+    auto area = level::Area(timed(level::gen), timed(level::gen_lod));
+    area.radius = n / 2;
+    area.lod_levels = levels;
+    area.center = glm::ivec3(0);
+    state.throttles.gen_max = std::numeric_limits<usize>::max();
+
+    // every level is complete once all of its range is loaded, but for
+    // inner chunks which the level below covers
+    const auto complete = [&]() {
+        for (usize level = 0; level <= levels; level++) {
+            const auto [min, max] = area.lod_range(level);
+            for (int x = min.x; x <= max.x; x++) {
+                for (int z = min.z; z <= max.z; z++) {
+                    const auto offset = glm::ivec3(x, 0, z);
+                    if ((level == 0 || !area.lod_inner(level, offset))
+                            && !area.lodp(level, offset)) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    };
+
+    while (!complete()) {
+        state.throttles.gen = 0;
+        area.tick();
+    }
+
+    // drops inner chunks generated before the level below was loaded
+    area.tick();
+
+    // quads and storage by level
+    struct Level {
+        usize chunks, bytes, quads;
+    };
+
+    std::array<Level, level::Area::LOD_LEVELS + 1> stats = {};
+    level::ChunkRenderer::Build build;
+
+    const auto mesh = [&](const level::ChunkGrid &chunks, Level &stats) {
+        for (auto *chunk : chunks) {
+            bench::mesh(*chunk, build);
+
+            stats.chunks++;
+            stats.bytes += chunk->bytes();
+            for (const auto &section : build.sections) {
+                stats.quads += section.num_quads();
+            }
+        }
+    };
+
+    mesh(area.chunks, stats[0]);
+    for (usize level = 1; level <= levels; level++) {
+        mesh(area.lods[level - 1], stats[level]);
+    }
+
+    const auto &full = stats[0];
+    const f64
+        quads_per_chunk = full.quads / static_cast<f64>(full.chunks),
+        bytes_per_chunk = full.bytes / static_cast<f64>(full.chunks);
+
+    for (usize level = 0; level <= levels; level++) {
+        const auto &s = stats[level];
+
+        // the area's chunks which this level's chunks stand in for
+        const usize covered = s.chunks << (2 * level);
+
+        util::log::out()
+            << "level " << level << " (" << (1 << level) << "x, "
+            << (area.lod_radius(level) * level::Chunk::SIZE.x)
+            << " tiles): "
+            << s.chunks << " chunks, "
+            << std::fixed << std::setprecision(3)
+            << (util::Time::to_millis<f64>(gen_ns[level])
+                    / gen_chunks[level])
+            << " ms/chunk to generate (" << gen_chunks[level]
+            << " generated), "
+            << s.quads << " quads ("
+            << std::setprecision(0)
+            << (quads_per_chunk * covered) << " at full resolution), "
+            << (s.bytes / 1024) << " KiB ("
+            << ((bytes_per_chunk * covered) / 1024) << " KiB at full "
+            << "resolution)"
+            << util::log::end;
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+// chunk meshing: meshes every chunk of a generated area with each mesher,
+// reports chunks/second and quads, and heap allocations made while meshing
+// once every build's storage has been sized by a first pass
+// exits with 1 if meshing allocates in steady state
+// usage: bench-mesh [N = 9]
+#define BENCH_COUNT_ALLOCATIONS
+#include "bench.hpp"
+#include "level/area.hpp"
+#include "level/gen.hpp"
+
+int main(int argc, char *argv[]) {
+    bench::init();
+
+    const usize n = bench::arg(argc, argv, 1, 9);
+
+    auto area = level::Area(level::gen);
+    area.radius = n / 2;
+    area.center = glm::ivec3(0);
+    bench::generate(area);
+
+    std::vector<level::Chunk*> chunks;
+    std::vector<std::unique_ptr<level::ChunkRenderer::Build>> builds;
+    for (auto *chunk : area.chunks) {
+        chunks.push_back(chunk);
+        builds.push_back(std::make_unique<level::ChunkRenderer::Build>());
+    }
+
+    bool ok = true;
+
+    for (const auto mesher :
+            { level::ChunkRenderer::PER_FACE, level::ChunkRenderer::GREEDY }) {
+        // first pass sizes storage, second (of the same snapshots) is
+        // steady state
+        for (usize i = 0; i < builds.size(); i++) {
+            bench::mesh(*chunks[i], *builds[i], mesher);
+        }
+
+        const usize allocations_start = bench::allocations;
+        const auto start = bench::now();
+
+        for (auto &build : builds) {
+            level::ChunkRenderer::mesh(*build);
+        }
+
+        const auto elapsed = bench::now() - start;
+        const usize count = bench::allocations - allocations_start;
+        ok &= count == 0;
+
+        usize quads = 0;
+        for (const auto &build : builds) {
+            for (const auto &section : build->sections) {
+                quads += section.num_vertices() / 4;
+            }
+        }
+
+        util::log::out()
+            << (mesher == level::ChunkRenderer::GREEDY ?
+                "greedy" : "per face") << ": "
+            << std::fixed << std::setprecision(2)
+            << (builds.size() / util::Time::to_seconds<f64>(elapsed))
+            << " chunks/s, "
+            << quads << " quads, "
+            << count << " allocations"
+            << util::log::end;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// batch noise: parity of every Octave::Batch instruction set (and of
+// Combined::sample_batch) against per-sample scalar noise, and throughput in
+// samples/second
+// exits with 1 if any batch result differs from the scalar one
+#include "bench.hpp"
+
+static constexpr usize NUM_SAMPLES = 1 << 20;
+
+// runs f, logs samples/second
+template <typename F>
+static void run(const std::string &name, F f) {
+    const auto start = bench::now();
+    f();
+    const auto elapsed = bench::now() - start;
+
+    util::log::out()
+        << name << ": "
+        << std::fixed << std::setprecision(2)
+        << (NUM_SAMPLES / (elapsed / 1e9) / 1e6) << " M samples/s"
+        << util::log::end;
+}
+
+// number of results which are not bit-identical
+static usize mismatches(
+    const std::vector<f32> &expected, const std::vector<f32> &actual) {
+    usize n = 0;
+    for (usize i = 0; i < expected.size(); i++) {
+        if (std::memcmp(&expected[i], &actual[i], sizeof(f32)) != 0) {
+            n++;
+        }
+    }
+    return n;
+}
+
+int main(UNUSED int argc, UNUSED char *argv[]) {
+    bench::init();
+
+    // random world-scale positions plus a run of exact integers, which hit
+    // noise1234's FASTFLOOR edge case
+    auto rand = util::rand(0x2015E);
+    std::vector<glm::vec2> points(NUM_SAMPLES);
+    for (auto &p : points) {
+        p = glm::vec2(
+            rand.next<f32>(-100000.0f, 100000.0f),
+            rand.next<f32>(-100000.0f, 100000.0f));
+    }
+
+    for (int i = 0; i < 4096; i++) {
+        points[i] = glm::vec2(i - 2048, (i % 17) - 8);
+    }
+
+    // same parameters as level::gen
+    auto octave = util::Octave(4, 8, 1), other = util::Octave(4, 8, 2);
+    const auto combined = util::Combined(octave, other);
+
+    std::vector<f32> expected(NUM_SAMPLES), actual(NUM_SAMPLES);
+    bool ok = true;
+
+    util::log::out()
+        << NUM_SAMPLES << " samples, best supported batch: "
+        << octave.batch_support()
+        << util::log::end;
+
+    run("Octave::sample", [&]() {
+        for (usize i = 0; i < NUM_SAMPLES; i++) {
+            expected[i] = octave.sample(points[i]);
+        }
+    });
+
+    for (usize b = 0; b <= util::Octave::batch_support(); b++) {
+        const auto batch = static_cast<util::Octave::Batch>(b);
+        const std::string name =
+            std::array { "SCALAR", "SSE4", "AVX2" }[b];
+
+        std::fill(actual.begin(), actual.end(), 0.0f);
+        run("Octave::sample_batch (" + name + ")", [&]() {
+            octave.sample_batch(batch, points, actual);
+        });
+
+        const usize n = mismatches(expected, actual);
+        ok &= n == 0;
+        util::log::out()
+            << "  " << n << " mismatches"
+            << util::log::end;
+    }
+
+    run("Combined::sample", [&]() {
+        for (usize i = 0; i < NUM_SAMPLES; i++) {
+            expected[i] = combined.sample(points[i]);
+        }
+    });
+
+    std::fill(actual.begin(), actual.end(), 0.0f);
+    run("Combined::sample_batch", [&]() {
+        combined.sample_batch(points, actual);
+    });
+
+    const usize n = mismatches(expected, actual);
+    ok &= n == 0;
+    util::log::out()
+        << "  " << n << " mismatches"
+        << util::log::end;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+// software occlusion buffer: checks a known scene (a wall hiding a box behind
+// it but not boxes in front of it, beside it, straddling its edge or behind
+// the camera), compares SIMD and scalar depth buffers bit for bit over random
+// triangles and reports triangles/ms for each
+// exits with 1 if any check fails
+// usage: bench-occlusion [triangles = 100000]
+#include "bench.hpp"
+
+// random triangles in front of a camera at the origin looking down -z, some
+// partially behind it
+static std::vector<std::array<glm::vec3, 3>> triangles(usize n) {
+    auto rand = util::rand(0x0CC1);
+    std::vector<std::array<glm::vec3, 3>> result(n);
+
+    for (auto &t : result) {
+        const auto center =
+            glm::vec3(
+                rand.gaussian() * 16.0,
+                rand.gaussian() * 8.0,
+                -1.0 - std::abs(rand.gaussian() * 32.0));
+
+        for (auto &v : t) {
+            v = center
+                + glm::vec3(
+                    rand.gaussian() * 3.0,
+                    rand.gaussian() * 3.0,
+                    rand.gaussian() * 3.0);
+        }
+    }
+
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    bench::init();
+
+    const usize n = bench::arg(argc, argv, 1, 100000);
+
+    const auto view_proj =
+        glm::perspective(glm::radians(90.0f), 2.0f, 0.1f, 256.0f)
+            * glm::lookAt(
+                glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                glm::vec3(0.0f, 1.0f, 0.0f));
+
+    usize failures = 0;
+
+    // known scene, on both paths
+    for (const bool simd : { false, true }) {
+        if (simd && !util::OcclusionBuffer::simd_support()) {
+            continue;
+        }
+
+        auto buffer = util::OcclusionBuffer();
+        buffer.simd = simd;
+        buffer.clear(view_proj);
+        buffer.occluder(
+            util::AABB(glm::vec3(-2, -2, -6), glm::vec3(2, 2, -5)),
+            glm::vec3(0.0f));
+
+        // name, box, expected result
+        const std::vector<std::tuple<std::string, util::AABB, bool>>
+            checks = {
+                { "behind",
+                  util::AABB(glm::vec3(-1, -1, -20), glm::vec3(1, 1, -18)),
+                  true },
+                { "in front",
+                  util::AABB(glm::vec3(-1, -1, -3), glm::vec3(1, 1, -2)),
+                  false },
+                { "beside",
+                  util::AABB(glm::vec3(12, -1, -20), glm::vec3(14, 1, -18)),
+                  false },
+                { "edge",
+                  util::AABB(glm::vec3(6, -1, -20), glm::vec3(10, 1, -18)),
+                  false },
+                { "behind camera",
+                  util::AABB(glm::vec3(-1, -1, 2), glm::vec3(1, 1, 4)),
+                  false }
+            };
+
+        for (const auto &[name, box, expected] : checks) {
+            const bool occluded = buffer.occluded(box);
+            if (occluded != expected) {
+                failures++;
+                util::log::out()
+                    << (simd ? "simd" : "scalar") << ": " << name
+                    << " should " << (expected ? "" : "not ")
+                    << "be occluded"
+                    << util::log::end;
+            }
+        }
+    }
+
+    // parity and throughput over random triangles
+    const auto tris = triangles(n);
+    std::vector<std::vector<f32>> depths;
+
+    for (const bool simd : { false, true }) {
+        if (simd && !util::OcclusionBuffer::simd_support()) {
+            util::log::out() << "no SIMD support" << util::log::end;
+            continue;
+        }
+
+        auto buffer = util::OcclusionBuffer();
+        buffer.simd = simd;
+        buffer.clear(view_proj);
+
+        const auto start = bench::now();
+        for (const auto &[a, b, c] : tris) {
+            buffer.occluder(a, b, c);
+        }
+        const auto elapsed = bench::now() - start;
+
+        util::log::out()
+            << (simd ? "simd" : "scalar") << ": "
+            << buffer.rasterized << "/" << buffer.triangles
+            << " triangles rasterized, "
+            << std::fixed << std::setprecision(1)
+            << (n / util::Time::to_millis<f64>(elapsed)) << " triangles/ms"
+            << util::log::end;
+
+        depths.push_back(std::move(buffer.depth));
+    }
+
+    if (depths.size() == 2) {
+        const bool equal =
+            std::memcmp(
+                depths[0].data(), depths[1].data(),
+                depths[0].size() * sizeof(f32)) == 0;
+
+        util::log::out()
+            << "simd/scalar depth: " << (equal ? "identical" : "DIFFERENT")
+            << util::log::end;
+        failures += !equal;
+    }
+
+    util::log::out() << failures << " failures" << util::log::end;
+    return failures == 0 ? 0 : 1;
+}
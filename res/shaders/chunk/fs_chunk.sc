@@ -5,7 +5,7 @@ $input v_texcoord0, v_normal, v_position, v_color0
 SAMPLER2D(s_tex, 0);
 
 void main() {
-    vec4 color = texture2D(s_tex, v_texcoord0);
+    vec4 color = texture2D(s_tex, tile_uv(v_texcoord0, v_color0));
 
     if (color.a < EPSILON) {
         discard;
@@ -25,6 +25,43 @@ uint decode_u8(float value) {
     return (uint) floor(value * 255.0);
 }
 
+// unpacks a ChunkVertex (see chunk.hpp) from its two attributes into its
+// chunk space position, normal, uv (in tiles) and color: atlas cell offset
+// (xy), atlas cell size (z), shininess (w)
+#define CHUNK_ATLAS_SIZE 16.0
+void unpack_chunk_vertex(
+    vec4 a, vec4 b,
+    out vec3 position, out vec3 normal, out vec2 uv, out vec4 color) {
+    position = a.xyz;
+
+    // face is a util::Direction: south, north, east, west, top, bottom
+    float axis = floor(a.w / 2.0);
+    float s = 1.0 - (2.0 * (a.w - (axis * 2.0)));
+    normal =
+        s * vec3(
+            step(0.5, axis) * step(axis, 1.5),
+            step(1.5, axis),
+            step(axis, 0.5));
+
+    uv = b.xy;
+
+    vec2 cell =
+        vec2(
+            mod(b.z, CHUNK_ATLAS_SIZE),
+            CHUNK_ATLAS_SIZE - floor(b.z / CHUNK_ATLAS_SIZE) - 1.0);
+    color =
+        vec4(
+            cell / CHUNK_ATLAS_SIZE,
+            1.0 / CHUNK_ATLAS_SIZE,
+            b.w / 255.0);
+}
+
+// chunk texture coordinates: textures repeat once per tile, uv is in tiles
+// and color holds the atlas cell (xy) and its size (z)
+vec2 tile_uv(vec2 uv, vec4 color) {
+    return color.xy + (fract(uv) * color.z);
+}
+
 float lindepth(float d, float near, float far) {
 	return near * far / (far + d * (near - far));
 }
@@ -55,6 +55,6 @@ void main() {
     normal = normalize(normal) * 0.5 + 0.5;
     // v_normal = normal;
 
-	gl_FragData[0] = vec4(texture2D(s_tex, v_texcoord0).rgb, v_color0.w);
+	gl_FragData[0] = vec4(texture2D(s_tex, tile_uv(v_texcoord0, v_color0)).rgb, v_color0.w);
 	gl_FragData[1] = vec4(normal, encode_u8(FLAG_WATER));
 }
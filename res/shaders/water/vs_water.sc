@@ -1,12 +1,17 @@
-$input a_position, a_normal, a_texcoord0, a_color0
+$input a_position, a_texcoord0
 $output v_normal, v_texcoord0, v_position, v_color0
 
 #include "../common.sc"
 
 void main() {
-	gl_Position = mul(u_modelViewProj, vec4(a_position, 1.0));
-	v_texcoord0 = a_texcoord0;
-    v_color0 = a_color0;
-    v_normal = normalize(a_normal) * 0.5 + 0.5; // normalize, compress
-    v_position = mul(u_model[0], vec4(a_position, 1.0)).xyz;
+    vec3 position, normal;
+    vec2 uv;
+    vec4 color;
+    unpack_chunk_vertex(a_position, a_texcoord0, position, normal, uv, color);
+
+	gl_Position = mul(u_modelViewProj, vec4(position, 1.0));
+	v_texcoord0 = uv;
+    v_color0 = color;
+    v_normal = normal * 0.5 + 0.5; // compress
+    v_position = mul(u_model[0], vec4(position, 1.0)).xyz;
 }
@@ -0,0 +1,109 @@
+#include "gfx/geometry_pool.hpp"
+#include "bgfx/defines.h"
+
+using namespace gfx;
+
+GeometryPool::Range GeometryPool::alloc(u32 count) {
+    util::_assert(
+        count > 0 && count <= this->page_vertices,
+        "GeometryPool allocation does not fit in a page");
+
+    // first fit, lowest page first so that later pages drain out
+    for (u32 p = 0; p < this->pages.size(); p++) {
+        auto &page = this->pages[p];
+        if (this->page_vertices - page.used < count) {
+            continue;
+        }
+
+        for (auto it = page.free.begin(); it != page.free.end(); it++) {
+            const auto [start, size] = *it;
+            if (size < count) {
+                continue;
+            }
+
+            page.free.erase(it);
+            if (size > count) {
+                page.free[start + count] = size - count;
+            }
+
+            page.used += count;
+            return Range { p, start, count };
+        }
+    }
+
+    auto &page = this->pages.emplace_back();
+    page.buffer =
+        util::RDUniqueResource<bgfx::DynamicVertexBufferHandle>(
+            bgfx::createDynamicVertexBuffer(
+                this->page_vertices,
+                this->layout,
+                BGFX_BUFFER_NONE),
+            [](auto handle) { bgfx::destroy(handle); });
+
+    if (count < this->page_vertices) {
+        page.free[count] = this->page_vertices - count;
+    }
+
+    page.used = count;
+    return Range { static_cast<u32>(this->pages.size() - 1), 0, count };
+}
+
+void GeometryPool::free(Range &range) {
+    if (range.empty()) {
+        return;
+    }
+
+    auto &page = this->pages[range.page];
+    u32 start = range.start, count = range.count;
+
+    // merge with the free ranges on either side
+    auto next = page.free.lower_bound(start);
+    if (next != page.free.end() && next->first == start + count) {
+        count += next->second;
+        next = page.free.erase(next);
+    }
+
+    if (next != page.free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == start) {
+            start = prev->first;
+            count += prev->second;
+            page.free.erase(prev);
+        }
+    }
+
+    page.free[start] = count;
+    page.used -= range.count;
+    range = Range {};
+}
+
+void GeometryPool::update(
+    const Range &range, u32 offset, const bgfx::Memory *memory) const {
+    util::_assert(
+        offset + (memory->size / this->layout.getStride()) <= range.count,
+        "GeometryPool update out of range");
+    bgfx::update(
+        this->pages[range.page].buffer, range.start + offset, memory);
+}
+
+void GeometryPool::set(
+    u8 stream, const Range &range, u32 start, u32 count) const {
+    bgfx::setVertexBuffer(
+        stream, this->pages[range.page].buffer, range.start + start, count);
+}
+
+GeometryPool::Stats GeometryPool::stats() const {
+    Stats stats = { this->pages.size(), 0, 0, 0, 0 };
+
+    for (const auto &page : this->pages) {
+        stats.capacity += this->page_vertices;
+        stats.used += page.used;
+        stats.free_ranges += page.free.size();
+
+        for (const auto &[_, size] : page.free) {
+            stats.largest_free = std::max<usize>(stats.largest_free, size);
+        }
+    }
+
+    return stats;
+}
@@ -0,0 +1,87 @@
+#ifndef GFX_GEOMETRY_POOL_HPP
+#define GFX_GEOMETRY_POOL_HPP
+
+#include "bgfx/bgfx.h"
+#include "util/util.hpp"
+#include "gfx/bgfx.hpp"
+
+namespace gfx {
+// suballocates ranges of vertices out of a few large dynamic vertex buffers
+// (pages) of one layout, so that meshes need no GPU buffers of their own
+// first fit over a free list per page, coalesced on free
+// pages are created as needed and kept until the pool is destroyed
+struct GeometryPool {
+    // vertices per page unless specified
+    static constexpr u32 DEFAULT_PAGE_VERTICES = 1 << 20;
+
+    // range of vertices in a page, empty if count == 0
+    struct Range {
+        u32 page = 0, start = 0, count = 0;
+
+        inline bool empty() const {
+            return this->count == 0;
+        }
+    };
+
+    struct Page {
+        util::RDUniqueResource<bgfx::DynamicVertexBufferHandle> buffer;
+
+        // free ranges by start, start -> count, never adjacent to each other
+        std::map<u32, u32> free;
+
+        // vertices allocated
+        u32 used = 0;
+    };
+
+    struct Stats {
+        usize pages, capacity, used, free_ranges, largest_free;
+
+        // share of capacity which is allocated
+        inline f64 utilization() const {
+            return this->capacity == 0 ?
+                0.0 : this->used / static_cast<f64>(this->capacity);
+        }
+
+        // share of free vertices which are not in the largest free range
+        inline f64 fragmentation() const {
+            const usize free = this->capacity - this->used;
+            return free == 0 ?
+                0.0 : 1.0 - (this->largest_free / static_cast<f64>(free));
+        }
+    };
+
+    // must outlive the pool, pages are created with it as they are needed
+    const bgfx::VertexLayout &layout;
+    u32 page_vertices;
+
+    std::vector<Page> pages;
+
+    explicit GeometryPool(
+        const bgfx::VertexLayout &layout,
+        u32 page_vertices = DEFAULT_PAGE_VERTICES)
+        : layout(layout),
+          page_vertices(page_vertices) {}
+    GeometryPool(const GeometryPool &other) = delete;
+    GeometryPool(GeometryPool &&other) = default;
+
+    // range of count vertices, in a new page if none has space
+    // count must be in (0, page_vertices]
+    Range alloc(u32 count);
+
+    // returns range to its page and empties it, does nothing if it is empty
+    void free(Range &range);
+
+    // uploads memory (a multiple of the layout's stride) to range starting
+    // at its vertex offset
+    void update(
+        const Range &range, u32 offset, const bgfx::Memory *memory) const;
+
+    // binds count vertices of range starting at its vertex start, which is
+    // also the base vertex of indices
+    void set(u8 stream, const Range &range, u32 start, u32 count) const;
+
+    Stats stats() const;
+};
+}
+
+#endif
@@ -6,6 +6,8 @@
 
 // gfx headers
 #include "gfx/util.hpp"
+#include "gfx/geometry_pool.hpp"
+#include "gfx/ref_pool.hpp"
 #include "gfx/renderer.hpp"
 
 #endif
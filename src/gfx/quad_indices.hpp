@@ -0,0 +1,77 @@
+#ifndef GFX_QUAD_INDICES_HPP
+#define GFX_QUAD_INDICES_HPP
+
+#include "bgfx/bgfx.h"
+#include "util/util.hpp"
+#include "gfx/bgfx.hpp"
+
+namespace gfx {
+// index buffer for lists of quads, 4 vertices each drawn as the triangles
+// {0, 1, 2} and {0, 2, 3}, shared by everything which draws quads so that
+// they need no index buffers of their own
+// recreated larger on demand, 16-bit until it needs to address more vertices
+struct QuadIndices {
+    // indices of each quad, relative to its first vertex
+    static constexpr u32 QUAD[] = { 0, 1, 2, 0, 2, 3 };
+
+    // size of the first buffer, in quads
+    static constexpr usize MIN_QUADS = 4096;
+
+    // number of quads which can be drawn at once
+    usize capacity = 0;
+
+    util::RDUniqueResource<bgfx::IndexBufferHandle> buffer;
+
+    // ensures n quads can be drawn at once
+    inline void reserve(usize n) {
+        if (n <= this->capacity) {
+            return;
+        }
+
+        this->capacity = std::max(std::bit_ceil(n), MIN_QUADS);
+
+        if (this->index32()) {
+            this->buffer = create<u32>(this->capacity, BGFX_BUFFER_INDEX32);
+        } else {
+            this->buffer = create<u16>(this->capacity, BGFX_BUFFER_NONE);
+        }
+    }
+
+    // binds the first n quads, which index from the start vertex of the
+    // bound vertex buffer range
+    inline void set(usize n) const {
+        util::_assert(n <= this->capacity, "QuadIndices not large enough");
+        bgfx::setIndexBuffer(this->buffer, 0, n * 6);
+    }
+
+    inline bool index32() const {
+        return this->capacity * 4 > std::numeric_limits<u16>::max() + 1;
+    }
+
+    inline usize bytes() const {
+        return this->capacity
+            * 6
+            * (this->index32() ? sizeof(u32) : sizeof(u16));
+    }
+
+private:
+    template <typename T>
+    static util::RDUniqueResource<bgfx::IndexBufferHandle> create(
+        usize quads, u16 flags) {
+        const auto *mem = bgfx::alloc(quads * 6 * sizeof(T));
+        auto *indices = reinterpret_cast<T*>(mem->data);
+
+        for (usize q = 0; q < quads; q++) {
+            for (const u32 i : QUAD) {
+                *indices++ = static_cast<T>((q * 4) + i);
+            }
+        }
+
+        return util::RDUniqueResource<bgfx::IndexBufferHandle>(
+            bgfx::createIndexBuffer(mem, flags),
+            [](auto handle) { bgfx::destroy(handle); });
+    }
+};
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef GFX_REF_POOL_HPP
+#define GFX_REF_POOL_HPP
+
+#include "bgfx/bgfx.h"
+#include "util/util.hpp"
+#include "gfx/bgfx.hpp"
+
+namespace gfx {
+// hands vectors of T to bgfx by reference (bgfx::makeRef) instead of copying
+// them, each stays owned by the pool until bgfx releases it (once the render
+// thread has consumed it) and its storage is then handed back out by ref()
+// in exchange for the next vector
+// released storage outlives the pool if bgfx still holds it when the pool is
+// destroyed
+// NOTE: ref()/copy() and counters are main thread only, releases may come
+// from the render thread
+template <typename T>
+struct RefPool {
+    using Buffer = std::vector<T>;
+
+    // if unset, ref() copies like copy() and never swaps storage
+    bool zero_copy = true;
+
+    // bytes handed to bgfx by copy and by reference
+    usize copied = 0, referenced = 0;
+
+    // times ref() had no released storage large enough and allocated
+    usize grown = 0;
+
+    RefPool()
+        : shared(std::make_shared<Shared>()) {}
+    RefPool(const RefPool &other) = delete;
+    RefPool(RefPool &&other) = delete;
+    RefPool &operator=(const RefPool &other) = delete;
+    RefPool &operator=(RefPool &&other) = delete;
+
+    ~RefPool() {
+        std::lock_guard lock(this->shared->mutex);
+        this->shared->closed = true;
+
+        for (auto *node : this->shared->released) {
+            delete node;
+        }
+        this->shared->released.clear();
+    }
+
+    // references buffer's contents, which must not be empty, and swaps
+    // buffer with empty storage of at least the same capacity, released
+    // earlier if any is large enough (the smallest which is) so that it can
+    // be filled again right away without allocating
+    const bgfx::Memory *ref(Buffer &buffer) {
+        if (!this->zero_copy) {
+            return this->copy(buffer);
+        }
+
+        const usize capacity = buffer.capacity();
+
+        // smallest which fits, otherwise the largest to be grown
+        Node *node = nullptr;
+        {
+            std::lock_guard lock(this->shared->mutex);
+            auto &released = this->shared->released;
+
+            auto best = released.end();
+            for (auto it = released.begin(); it != released.end(); it++) {
+                const usize c = (*it)->buffer.capacity();
+                if (best == released.end()) {
+                    best = it;
+                    continue;
+                }
+
+                const usize b = (*best)->buffer.capacity();
+                if (b >= capacity ?
+                        (c >= capacity && c < b) : c > b) {
+                    best = it;
+                }
+            }
+
+            if (best != released.end()) {
+                node = *best;
+                *best = released.back();
+                released.pop_back();
+            }
+        }
+
+        if (!node) {
+            node = new Node { this->shared, {} };
+        }
+
+        std::swap(node->buffer, buffer);
+        buffer.clear();
+
+        if (buffer.capacity() < capacity) {
+            buffer.reserve(capacity);
+            this->grown++;
+        }
+
+        const usize size = node->buffer.size() * sizeof(T);
+        this->referenced += size;
+        this->shared->in_flight++;
+        return bgfx::makeRef(node->buffer.data(), size, release, node);
+    }
+
+    // copies buffer's contents into memory owned by bgfx
+    const bgfx::Memory *copy(const Buffer &buffer) {
+        const usize size = buffer.size() * sizeof(T);
+        this->copied += size;
+        return bgfx::copy(buffer.data(), size);
+    }
+
+    // buffers referenced by bgfx which it has not released yet
+    inline usize in_flight() const {
+        return this->shared->in_flight.load();
+    }
+
+private:
+    struct Node;
+
+    struct Shared {
+        std::mutex mutex;
+        std::vector<Node*> released;
+        std::atomic<usize> in_flight = 0;
+        bool closed = false;
+    };
+
+    struct Node {
+        std::shared_ptr<Shared> shared;
+        Buffer buffer;
+    };
+
+    std::shared_ptr<Shared> shared;
+
+    // bgfx::ReleaseFn, called once bgfx is done with a node's buffer
+    static void release(UNUSED void *data, void *user_data) {
+        auto *node = reinterpret_cast<Node*>(user_data);
+        auto shared = node->shared;
+        shared->in_flight--;
+
+        std::lock_guard lock(shared->mutex);
+        if (shared->closed) {
+            delete node;
+            return;
+        }
+
+        node->buffer.clear();
+        shared->released.push_back(node);
+    }
+};
+}
+
+#endif
@@ -95,6 +95,7 @@ void Renderer::init() {
 
     this->capabilities = *bgfx::getCaps();
     this->primitive = std::unique_ptr<Primitive>(new Primitive());
+    this->quad_indices = std::make_unique<QuadIndices>();
 
     // generate noise texture
     const auto noise_size = glm::vec2(128, 128);
@@ -272,6 +273,7 @@ Renderer::~Renderer() {
     }
 
     this->primitive.reset();
+    this->quad_indices.reset();
     bgfx::shutdown();
 }
 
@@ -342,11 +344,12 @@ void Renderer::composite(RenderFn render) {
         this->view_sun,
         BGFX_STATE_WRITE_Z
         | BGFX_STATE_DEPTH_TEST_LESS
-        | BGFX_STATE_CULL_CCW);
+        | BGFX_STATE_CULL_CCW,
+        this->sun.camera);
 
     // render to deferred buffers
     this->look_camera->set_view_transform(this->view_gbuffer);
-    render(this->view_gbuffer, 0);
+    render(this->view_gbuffer, 0, *this->look_camera);
 
     // render to light buffer
     this->sun.direction = glm::vec3(0.60f, -0.7f, -0.30f);
@@ -6,6 +6,7 @@
 #include "gfx/util.hpp"
 #include "gfx/program.hpp"
 #include "gfx/primitive.hpp"
+#include "gfx/quad_indices.hpp"
 #include "gfx/texture.hpp"
 #include "gfx/framebuffer.hpp"
 #include "gfx/sun.hpp"
@@ -23,6 +24,7 @@ struct Renderer {
     std::unordered_map<
         std::string, std::unique_ptr<Framebuffer>> framebuffers;
     std::unique_ptr<Primitive> primitive;
+    std::unique_ptr<QuadIndices> quad_indices;
 
     bgfx::ViewId
         view_main = 0,
@@ -65,7 +67,10 @@ struct Renderer {
     void prepare_frame();
     void end_frame();
 
-    using RenderFn = std::function<void(bgfx::ViewId, u64)>;
+    // called with each view to render the scene into, its render state and
+    // the camera it is rendered from
+    using RenderFn =
+        std::function<void(bgfx::ViewId, u64, const util::Camera&)>;
     void composite(RenderFn render);
 };
 
@@ -3,79 +3,617 @@
 
 using namespace level;
 
-Area::Area(GeneratorFn generator) : generator(generator) {
+Area::Area(GeneratorFn generator, GeneratorFn lod_generator)
+    : chunk_pool(
+        Area::CHUNK_SLAB_SIZE,
+        state.platform.settings["level"]["huge_pages"].value_or(false)),
+      chunks((this->radius * 2) + 1),
+      generator(generator),
+      lod_generator(lod_generator) {
     this->raw = AreaDataAccess<decltype(Chunk::raw)>(this, &Chunk::raw);
     this->tiles = AreaDataAccess<decltype(Chunk::tiles)>(this, &Chunk::tiles);
+
+    auto &settings = state.platform.settings;
+    this->gen_threads =
+        std::max<i64>(settings["gen"]["threads"].value_or(2), 0);
+    this->gen_integrate_max =
+        std::max<i64>(settings["gen"]["integrate_max"].value_or(8), 1);
+
+    for (auto &grid : this->lods) {
+        grid = ChunkGrid((this->radius * 2) + 2);
+    }
+
+    this->lod_levels =
+        lod_generator ?
+            std::clamp<i64>(
+                settings["level"]["lod_levels"].value_or(3), 0, LOD_LEVELS)
+            : 0;
+}
+
+Area::~Area() {
+    // jobs stop once the queue is empty
+    {
+        std::lock_guard lock(this->gen_mutex);
+        this->gen_queue.clear();
+    }
+
+    for (const auto &job : this->gen_jobs) {
+        state.jobs.wait(job);
+    }
+
+    for (const auto &pending : this->lod_pending) {
+        for (const auto &[_, p] : pending) {
+            if (p.job) {
+                state.jobs.wait(p.job);
+            }
+        }
+    }
 }
 
 void Area::update() {
 
 }
 
+Chunk &ChunkGrid::insert(Ptr &&chunk) {
+    auto &slot = this->slots[this->slot(chunk->offset)];
+    util::_assert(!slot, "ChunkGrid slot already occupied");
+
+    slot = std::move(chunk);
+    this->count++;
+
+    // directions are in opposing pairs, d ^ 1 is the opposite of d
+    for (const util::Direction d : util::Direction::ALL) {
+        auto *neighbor =
+            this->get(slot->offset + static_cast<glm::ivec3>(d));
+        slot->links[d] = neighbor;
+
+        if (neighbor) {
+            neighbor->links[d ^ 1] = slot.get();
+        }
+    }
+
+    return *slot;
+}
+
+ChunkGrid::Ptr ChunkGrid::remove(const glm::ivec3 &offset) {
+    if (!this->get(offset)) {
+        return Ptr();
+    }
+
+    auto chunk = std::move(this->slots[this->slot(offset)]);
+    this->count--;
+
+    for (const util::Direction d : util::Direction::ALL) {
+        if (auto *neighbor = chunk->links[d]) {
+            neighbor->links[d ^ 1] = nullptr;
+        }
+        chunk->links[d] = nullptr;
+    }
+
+    return chunk;
+}
+
+// inserts chunk into grid, neighboring chunks need to remesh their borders
+static Chunk &insert(ChunkGrid &grid, util::Pool<Chunk>::Ptr &&ptr) {
+    auto &chunk = grid.insert(std::move(ptr));
+
+    for (auto *c : chunk.neighbors()) {
+        if (c) {
+            c->dirty(0, Chunk::SIZE.y - 1);
+        }
+    }
+
+    return chunk;
+}
+
+Chunk &Area::publish(util::Pool<Chunk>::Ptr &&ptr) {
+    return insert(this->chunks, std::move(ptr));
+}
+
+usize Area::lod_jobs() const {
+    usize n = 0;
+    for (const auto &pending : this->lod_pending) {
+        for (const auto &[_, p] : pending) {
+            n += p.job && !util::Jobs::done(p.job);
+        }
+    }
+    return n;
+}
+
+bool Area::lod_loaded(usize level, const glm::ivec3 &offset) {
+    if (this->lodp(level, offset)) {
+        return true;
+    } else if (level == 0 || !this->lod_inner(level, offset)) {
+        return false;
+    }
+
+    for (int x = 0; x < 2; x++) {
+        for (int z = 0; z < 2; z++) {
+            if (!this->lod_loaded(
+                    level - 1, (offset * 2) + glm::ivec3(x, 0, z))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void Area::tick_lods() {
+    const auto center_offset = Area::to_offset(this->center);
+    const bool async = this->gen_threads > 0 && state.jobs.size() > 0;
+
+    // offsets which are missing by level, with their distance to center
+    struct Missing {
+        usize level;
+        glm::ivec3 offset;
+        f32 distance;
+    };
+
+    // shares gen_threads with the area's own chunks, which go first
+    std::vector<Missing> missing;
+    usize generating = this->gen_jobs.size();
+
+    for (usize level = 1; level <= LOD_LEVELS; level++) {
+        auto &grid = this->lods[level - 1];
+        auto &pending = this->lod_pending[level - 1];
+        const auto range = this->lod_range(level);
+        const auto min = range.first, max = range.second;
+
+        // everything is unloaded from levels past lod_levels
+        const auto in_range = [&](const glm::ivec3 &offset) {
+            return level <= this->lod_levels
+                && offset.x >= min.x && offset.z >= min.z
+                && offset.x <= max.x && offset.z <= max.z;
+        };
+
+        // inner chunks are not needed once the level below has loaded all
+        // of their columns, until then they fill in for it
+        const auto covered = [&](const glm::ivec3 &offset) {
+            if (!this->lod_inner(level, offset)) {
+                return false;
+            }
+
+            for (int x = 0; x < 2; x++) {
+                for (int z = 0; z < 2; z++) {
+                    if (!this->lod_loaded(
+                            level - 1,
+                            (offset * 2) + glm::ivec3(x, 0, z))) {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        };
+
+        std::vector<glm::ivec3> to_remove;
+        for (auto *chunk : grid) {
+            if (!in_range(chunk->offset) || covered(chunk->offset)) {
+                to_remove.push_back(chunk->offset);
+            }
+        }
+
+        for (const auto &offset : to_remove) {
+            grid.remove(offset);
+        }
+
+        // every level's range spans at most (radius * 2) + 2 chunks
+        const int diameter = (this->radius * 2) + 2;
+        if (grid.diameter != diameter) {
+            auto old = std::exchange(grid, ChunkGrid(diameter));
+
+            for (auto &slot : old.slots) {
+                if (slot) {
+                    const auto offset = slot->offset;
+                    grid.insert(old.remove(offset));
+                }
+            }
+        }
+
+        // publish finished chunks, dropping those which left the range
+        for (auto it = pending.begin(); it != pending.end();) {
+            auto &[offset, p] = *it;
+
+            if (p.job && !util::Jobs::done(p.job)) {
+                generating++;
+                it++;
+                continue;
+            }
+
+            if (in_range(offset) && !covered(offset)) {
+                insert(grid, std::move(p.chunk));
+            }
+
+            it = pending.erase(it);
+        }
+
+        if (level > this->lod_levels) {
+            continue;
+        }
+
+        const int size = 1 << level;
+        for (int x = min.x; x <= max.x; x++) {
+            for (int z = min.z; z <= max.z; z++) {
+                const auto offset = glm::ivec3(x, 0, z);
+                if (grid.get(offset)
+                        || pending.contains(offset)
+                        || covered(offset)) {
+                    continue;
+                }
+
+                const auto center =
+                    (glm::vec3(offset) + glm::vec3(0.5f, 0.0f, 0.5f))
+                        * static_cast<f32>(size);
+                missing.push_back({
+                    level, offset,
+                    glm::length2(center - glm::vec3(center_offset)) });
+            }
+        }
+    }
+
+    // nearest first, on jobs alongside the area's own chunks
+    std::sort(
+        missing.begin(), missing.end(),
+        [](const auto &a, const auto &b) { return a.distance < b.distance; });
+
+    for (const auto &[level, offset, _] : missing) {
+        if (async ?
+                generating >= this->gen_threads
+                : state.throttles.gen >= state.throttles.gen_max) {
+            break;
+        }
+
+        auto chunk = this->chunk_pool.make(*this, offset);
+        chunk->lod = level;
+
+        if (async) {
+            auto *c = chunk.get();
+            auto job =
+                state.jobs.submit([this, c]() { this->lod_generator(*c); });
+            this->lod_pending[level - 1][offset] =
+                { std::move(chunk), std::move(job) };
+            generating++;
+        } else {
+            this->lod_generator(*chunk);
+            insert(this->lods[level - 1], std::move(chunk));
+            state.throttles.gen++;
+        }
+    }
+}
+
 void Area::tick() {
     const auto
         center_offset = Area::to_offset(this->center),
         min_offset = center_offset - glm::ivec3(this->radius, 0, this->radius),
         max_offset = center_offset + glm::ivec3(this->radius, 0, this->radius);
 
+    const auto in_radius = [&](const glm::ivec3 &offset) {
+        return offset.x >= min_offset.x && offset.z >= min_offset.z
+            && offset.x <= max_offset.x && offset.z <= max_offset.z;
+    };
+
     // remove chunks which are not in radius
-    for (auto it = this->chunks.begin(); it != this->chunks.end();) {
-        auto &[offset, chunk] = *it;
+    std::vector<glm::ivec3> to_remove;
+    for (auto *chunk : this->chunks) {
+        if (!in_radius(chunk->offset)) {
+            to_remove.push_back(chunk->offset);
+        }
+    }
 
-        if (offset.x < min_offset.x || offset.z < min_offset.z ||
-            offset.x > max_offset.x || offset.z > max_offset.z) {
-            this->chunks.erase(it++);
-        } else {
-            it++;
+    for (const auto &offset : to_remove) {
+        this->chunks.remove(offset);
+    }
+
+    // resize grid if radius has changed, everything left is in radius
+    const int diameter = (this->radius * 2) + 1;
+    if (this->chunks.diameter != diameter) {
+        auto old = std::exchange(this->chunks, ChunkGrid(diameter));
+
+        for (auto &slot : old.slots) {
+            if (slot) {
+                const auto offset = slot->offset;
+                this->chunks.insert(old.remove(offset));
+            }
+        }
+    }
+
+    const bool async = this->gen_threads > 0 && state.jobs.size() > 0;
+
+    if (async) {
+        std::vector<Chunk*> done;
+
+        {
+            std::lock_guard lock(this->gen_mutex);
+
+            // cancel generation which has not started for chunks which are
+            // no longer in radius
+            for (auto it = this->gen_queue.begin();
+                 it != this->gen_queue.end();) {
+                if (!in_radius((*it)->offset)) {
+                    this->pending.erase((*it)->offset);
+                    it = this->gen_queue.erase(it);
+                } else {
+                    it++;
+                }
+            }
+
+            const usize n =
+                std::min(this->gen_done.size(), this->gen_integrate_max);
+            done.assign(this->gen_done.begin(), this->gen_done.begin() + n);
+            this->gen_done.erase(
+                this->gen_done.begin(), this->gen_done.begin() + n);
+        }
+
+        // publish finished chunks, dropping those which left the radius
+        // while they were being generated
+        for (auto *chunk : done) {
+            auto it = this->pending.find(chunk->offset);
+            auto ptr = std::move(it->second);
+            this->pending.erase(it);
+
+            if (in_radius(ptr->offset)) {
+                this->publish(std::move(ptr));
+            }
         }
     }
 
-    // add chunks which should be in radius but are not loaded
+    // find chunks which should be in radius but are not loaded, nearest first
+    std::vector<glm::ivec3> missing;
     for (int x = min_offset.x; x <= max_offset.x; x++) {
         for (int z = min_offset.z; z <= max_offset.z; z++) {
             const auto offset = glm::ivec3(x, 0, z);
 
-            if (!chunks.contains(offset) &&
-                state.throttles.gen < state.throttles.gen_max) {
-                auto chunk = new level::Chunk(*this, offset);
-                this->chunks.emplace(offset, chunk);
-                this->generator(*chunk);
-                state.throttles.gen++;
+            if (!this->contains_chunk(offset)
+                    && !this->pending.contains(offset)) {
+                missing.push_back(offset);
+            }
+        }
+    }
+
+    std::sort(
+        missing.begin(), missing.end(),
+        [&](const auto &a, const auto &b) {
+            return glm::length2(glm::vec3(a - center_offset))
+                < glm::length2(glm::vec3(b - center_offset));
+        });
+
+    if (!async) {
+        for (const auto &offset : missing) {
+            if (state.throttles.gen >= state.throttles.gen_max) {
+                break;
             }
+
+            auto chunk = this->chunk_pool.make(*this, offset);
+            this->generator(*chunk);
+            this->publish(std::move(chunk));
+            state.throttles.gen++;
+        }
+    } else if (!missing.empty()
+            || center_offset.xz() != this->gen_center) {
+        std::lock_guard lock(this->gen_mutex);
+
+        for (const auto &offset : missing) {
+            auto chunk = this->chunk_pool.make(*this, offset);
+            this->gen_queue.push_back(chunk.get());
+            this->pending[offset] = std::move(chunk);
         }
+
+        // new chunks and those queued around an earlier center, together
+        // nearest first
+        std::sort(
+            this->gen_queue.begin(), this->gen_queue.end(),
+            [&](const auto *a, const auto *b) {
+                return glm::length2(glm::vec3(a->offset - center_offset))
+                    < glm::length2(glm::vec3(b->offset - center_offset));
+            });
+        this->gen_center = center_offset.xz();
     }
 
+    // keep up to gen_threads jobs draining the queue
+    std::erase_if(this->gen_jobs, util::Jobs::done);
+
+    bool queued;
+    {
+        std::lock_guard lock(this->gen_mutex);
+        queued = !this->gen_queue.empty();
+    }
 
-    for (auto &[_, chunk] : this->chunks) {
+    // at most gen_threads jobs generating at once, together with
+    // downsampled chunks
+    const usize lod_jobs = this->lod_jobs();
+    while (async
+            && queued
+            && this->gen_jobs.size() + lod_jobs < this->gen_threads) {
+        this->gen_jobs.push_back(state.jobs.submit([this]() {
+            while (true) {
+                Chunk *chunk;
+
+                {
+                    std::lock_guard lock(this->gen_mutex);
+                    if (this->gen_queue.empty()) {
+                        return;
+                    }
+
+                    chunk = this->gen_queue.front();
+                    this->gen_queue.pop_front();
+                }
+
+                this->generator(*chunk);
+
+                std::lock_guard lock(this->gen_mutex);
+                this->gen_done.push_back(chunk);
+            }
+        }));
+    }
+
+    this->tick_lods();
+
+    for (auto *chunk : this->chunks) {
         chunk->tick();
     }
 }
 
+usize Area::bytes() const {
+    usize n = 0;
+
+    for (const auto *chunk : this->chunks) {
+        n += chunk->bytes();
+    }
+
+    return n;
+}
+
+usize Area::lod_bytes() const {
+    usize n = 0;
+
+    for (const auto &grid : this->lods) {
+        for (const auto *chunk : grid) {
+            n += chunk->bytes();
+        }
+    }
+
+    return n;
+}
+
+u64 Area::checksum() const {
+    std::vector<const Chunk*> sorted;
+    for (const auto *chunk : this->chunks) {
+        sorted.push_back(chunk);
+    }
+
+    std::sort(
+        sorted.begin(), sorted.end(),
+        [](const auto *a, const auto *b) {
+            return a->offset.x != b->offset.x ?
+                a->offset.x < b->offset.x
+                : a->offset.z < b->offset.z;
+        });
+
+    u64 h = 0;
+    for (const auto *chunk : sorted) {
+        h = util::mix_hash(h ^ std::hash<glm::ivec3>{}(chunk->offset));
+        h = util::mix_hash(h ^ chunk->checksum());
+    }
+    return h;
+}
+
+void Area::debug_stats() const {
+    const auto n = this->chunks.size();
+    const auto bytes = this->bytes();
+
+    util::log::out()
+        << "chunks: " << n
+        << " (" << this->pending.size() << " generating)"
+        << ", storage: " << (bytes / 1024) << " KiB"
+        << " (" << (n ? bytes / n : 0) << " B/chunk, flat "
+        << Chunk::FLAT_BYTES << " B/chunk)"
+        << util::log::end;
+
+    for (usize level = 1; level <= this->lod_levels; level++) {
+        util::log::out()
+            << "lod " << level << " (" << (1 << level) << "x): "
+            << this->lods[level - 1].size() << " chunks ("
+            << this->lod_pending[level - 1].size() << " generating)"
+            << util::log::end;
+    }
+
+    if (this->lod_levels > 0) {
+        util::log::out()
+            << "lod storage: " << (this->lod_bytes() / 1024) << " KiB"
+            << util::log::end;
+    }
+
+    this->chunk_pool.stats.debug_stats("chunk");
+
+    const auto &cache = gen_cache();
+    util::log::out()
+        << "gen cache: "
+        << std::fixed << std::setprecision(1)
+        << (cache.hit_rate() * 100.0) << "% hits, "
+        << std::setprecision(3)
+        << util::Time::to_millis(cache.saved_ns_per_chunk())
+        << " ms saved/chunk"
+        << util::log::end;
+}
+
+void Area::fill(const util::AABBi &box, Chunk::Data d) {
+    this->for_each_chunk(box, [&](Chunk &chunk, const util::AABBi &b) {
+        chunk.fill(b, d);
+    });
+}
+
+void Area::replace(
+    const util::AABBi &box, Chunk::Data from, Chunk::Data to) {
+    this->for_each_chunk(box, [&](Chunk &chunk, const util::AABBi &b) {
+        chunk.replace(b, from, to);
+    });
+}
+
+void Area::copy_region(const util::AABBi &box, const glm::ivec3 &dst) {
+    // read everything first as source and destination may overlap
+    const auto size = box.max - box.min + 1;
+    std::vector<Chunk::Data> buf(size.x * size.y * size.z, 0);
+
+    this->for_each_chunk(box, [&](Chunk &chunk, const util::AABBi &b) {
+        chunk.read(b, box.translate(-chunk.offset_tiles), &buf[0]);
+    });
+
+    const auto dst_box = box.translate(dst - box.min);
+    this->for_each_chunk(dst_box, [&](Chunk &chunk, const util::AABBi &b) {
+        chunk.write(b, dst_box.translate(-chunk.offset_tiles), &buf[0]);
+    });
+}
+
 usize Area::get_colliders(
     const std::span<util::AABB> &dest, util::AABBi area) {
     usize n = 0;
 
-    for (int x = area.min.x; x <= area.max.x; x++) {
-        for (int y = area.min.y; y <= area.max.y; y++) {
-            for (int z = area.min.z; z <= area.max.z; z++) {
-                const auto pos = glm::ivec3(x, y, z);
+    const auto
+        offset_min = Area::to_offset(area.min),
+        offset_max = Area::to_offset(area.max);
 
-                const TileId tile = this->tiles[pos];
-                if (tile == 0) {
-                    continue;
-                }
+    for (int x = offset_min.x; x <= offset_max.x; x++) {
+        for (int z = offset_min.z; z <= offset_max.z; z++) {
+            auto *chunk = this->chunkp(glm::ivec3(x, 0, z));
+            if (!chunk) {
+                continue;
+            }
 
-                if (n >= dest.size()) {
-                    util::log::out()
-                        << util::log::ERROR
-                        << "No more space in colliders container!"
-                        << util::log::end;
-                    goto end;
-                }
+            // area bounds in chunk space, empty sections are skipped
+            const auto
+                min = glm::max(
+                    area.min - chunk->offset_tiles, glm::ivec3(0)),
+                max = glm::min(
+                    area.max - chunk->offset_tiles, Chunk::SIZE - 1);
 
-                dest[n++] = state.tiles[tile].aabb(*this, pos);
-            }
+            glm::ivec3 p;
+            for (p.x = min.x; p.x <= max.x; p.x++) {
+                for (p.y = min.y; p.y <= max.y; p.y++) {
+                    if (chunk->empty(Chunk::section(p))) {
+                        continue;
+                    }
+
+                    for (p.z = min.z; p.z <= max.z; p.z++) {
+                        const TileId tile = chunk->tiles[p];
+                        if (tile == 0) {
+                            continue;
+                        }
+
+                        if (n >= dest.size()) {
+                            util::log::out()
+                                << util::log::ERROR
+                                << "No more space in colliders container!"
+                                << util::log::end;
+                            goto end;
+                        }
 
+                        dest[n++] =
+                            state.tiles[tile].aabb(
+                                *this, chunk->offset_tiles + p);
+                    }
+                }
+            }
         }
     }
 
@@ -6,8 +6,99 @@
 #include "level/gen.hpp"
 
 namespace level {
+// fixed-size toroidal grid of chunks, indexed by offset mod diameter
+// as long as all loaded chunks are within a (diameter x diameter) square
+// every chunk has its own slot
+struct ChunkGrid final {
+    using Ptr = util::Pool<Chunk>::Ptr;
+
+    struct iterator {
+        const ChunkGrid *grid;
+        usize i;
+
+        iterator(const ChunkGrid *grid, usize i) : grid(grid), i(i) {
+            this->skip();
+        }
+
+        inline Chunk *operator*() const {
+            return this->grid->slots[this->i].get();
+        }
+
+        inline iterator &operator++() {
+            this->i++;
+            this->skip();
+            return *this;
+        }
+
+        inline bool operator==(const iterator &other) const {
+            return this->i == other.i;
+        }
+
+        inline bool operator!=(const iterator &other) const {
+            return this->i != other.i;
+        }
+
+    private:
+        // advance to next occupied slot
+        inline void skip() {
+            while (this->i < this->grid->slots.size()
+                   && !this->grid->slots[this->i]) {
+                this->i++;
+            }
+        }
+    };
+
+    std::vector<Ptr> slots;
+    int diameter = 0;
+
+    ChunkGrid() = default;
+    explicit ChunkGrid(int diameter)
+        : slots(diameter * diameter), diameter(diameter) {}
+
+    // chunk at offset, nullptr if not present
+    inline Chunk *get(const glm::ivec3 &offset) const {
+        if (offset.y != 0) {
+            return nullptr;
+        }
+
+        auto *chunk = this->slots[this->slot(offset)].get();
+        return chunk && chunk->offset == offset ? chunk : nullptr;
+    }
+
+    // insert chunk into its slot (which must be empty) and link it to its
+    // neighbors
+    Chunk &insert(Ptr &&chunk);
+
+    // remove chunk from its slot and unlink it from its neighbors
+    Ptr remove(const glm::ivec3 &offset);
+
+    inline usize size() const {
+        return this->count;
+    }
+
+    inline iterator begin() const {
+        return iterator(this, 0);
+    }
+
+    inline iterator end() const {
+        return iterator(this, this->slots.size());
+    }
+
+private:
+    usize count = 0;
+
+    inline usize slot(const glm::ivec3 &offset) const {
+        const auto m =
+            ((offset.xz() % this->diameter) + this->diameter)
+                % this->diameter;
+        return m.x * this->diameter + m.y;
+    }
+};
+
 struct Area final
     : util::Updateable, util::Tickable {
+    // chunks per chunk_pool slab
+    static constexpr usize CHUNK_SLAB_SIZE = 256;
 
     // proxy for access to area data through chunk data proxy
     template <typename T>
@@ -23,11 +114,10 @@ struct Area final
 
         // returns a SafeProxy, use direct chunk access for better speed
         inline auto operator[](const glm::ivec3 &pos) {
-            const auto offset = Area::to_offset(pos);
+            auto *chunk = this->area->chunkp(Area::to_offset(pos));
             return
-                area->contains_chunk(offset) ?
-                    (this->area->chunk(offset).*this->member)
-                        .safe(Area::to_chunk_pos(pos))
+                chunk ?
+                    (chunk->*this->member).safe(Area::to_chunk_pos(pos))
                     : T::ZERO;
         }
     };
@@ -36,20 +126,77 @@ struct Area final
     AreaDataAccess<decltype(Chunk::raw)> raw;
     AreaDataAccess<decltype(Chunk::tiles)> tiles;
 
-    // chunk data
-    std::unordered_map<glm::ivec3, std::unique_ptr<Chunk>> chunks;
+    // radius (in chunks) around center which is loaded
+    usize radius = 10;
 
-    // data which was set outside of world bounds
-    std::vector<std::tuple<glm::ivec3, TileId>> out_of_bounds_tiles;
+    // chunk storage, must be declared before chunks
+    util::Pool<Chunk> chunk_pool;
+
+    // chunk data, sized to (radius * 2) + 1 on each side
+    ChunkGrid chunks;
 
     // TODO: replace when entities are added
     glm::ivec3 center;
 
+    // generator is called with chunks which are not yet part of the area,
+    // possibly from worker threads: it must only write to the chunk itself
+    // and its result must only depend on the chunk's offset, so that chunks
+    // can be generated in any order
     using GeneratorFn = std::function<void(Chunk &)>;
     GeneratorFn generator;
-    usize radius = 10;
 
-    explicit Area(GeneratorFn generator);
+    // chunks which are being generated (or queued to be), by offset
+    std::unordered_map<glm::ivec3, util::Pool<Chunk>::Ptr> pending;
+
+    // generation jobs (on state.jobs), configured by [gen] in settings
+    // gen_threads is the max. number of jobs generating at once (these and
+    // those of downsampled chunks, see lod_pending), 0 (or no job workers)
+    // generates on the main thread (throttled by state.throttles.gen_max),
+    // otherwise at most gen_integrate_max generated chunks are published
+    // per tick
+    usize gen_threads, gen_integrate_max;
+    std::vector<util::Jobs::Handle> gen_jobs;
+
+    // chunk offset (xz) of center which gen_queue is ordered around, nearest
+    // first, it is re-sorted whenever center moves to another chunk
+    glm::ivec2 gen_center = glm::ivec2(0);
+
+    // shared with jobs, protected by gen_mutex
+    std::mutex gen_mutex;
+    std::deque<Chunk*> gen_queue;
+    std::vector<Chunk*> gen_done;
+
+    // downsampled chunks (see Chunk::lod) in rings around the area for
+    // extended view distance: level L covers lod_radius(L) around center
+    // with chunks which each stand in for (2^L x 2^L) of the area's chunks
+    // its inner chunks (see lod_inner) are only loaded until the level below
+    // has loaded everything underneath them
+    // lod_levels from [level] lod_levels, 0 without a lod_generator
+    static constexpr usize LOD_LEVELS = 3;
+
+    // chunks (of the level below) by which inner chunks are inside the
+    // radius of the level below, more than AreaRenderer::LOD_HYSTERESIS so
+    // that the level below is refined before they are dropped
+    static constexpr int LOD_INNER_MARGIN = 4;
+    usize lod_levels;
+    std::array<ChunkGrid, LOD_LEVELS> lods;
+
+    // generates downsampled chunks, same rules as generator
+    GeneratorFn lod_generator;
+
+    // downsampled chunks being generated by level, each on its own job
+    // (counted against gen_threads along with gen_jobs), job is nullptr when
+    // generating on the main thread
+    struct LodPending {
+        util::Pool<Chunk>::Ptr chunk;
+        util::Jobs::Handle job;
+    };
+
+    std::array<std::unordered_map<glm::ivec3, LodPending>, LOD_LEVELS>
+        lod_pending;
+
+    explicit Area(GeneratorFn generator, GeneratorFn lod_generator = nullptr);
+    ~Area();
 
     void update() override;
     void tick() override;
@@ -57,31 +204,133 @@ struct Area final
     usize get_colliders(
         const std::span<util::AABB> &dest, util::AABBi area);
 
+    // approximate memory used by all loaded chunks
+    usize bytes() const;
+
+    // approximate memory used by all downsampled chunks
+    usize lod_bytes() const;
+
+    // hash of all loaded chunks' data (see Chunk::checksum) and offsets, in
+    // offset order so that it does not depend on load order
+    u64 checksum() const;
+
+    // logs chunk counts, storage, the chunk pool and the generation cache
+    void debug_stats() const;
+
+    // adds a generated chunk to the area
+    Chunk &publish(util::Pool<Chunk>::Ptr &&chunk);
+
+    // bulk operations on raw data over an inclusive box in area space, see
+    // Chunk::fill etc., parts of the box in chunks which are not loaded are
+    // ignored
+    void fill(const util::AABBi &box, Chunk::Data d);
+    void replace(const util::AABBi &box, Chunk::Data from, Chunk::Data to);
+
+    // copy box to dst (min corner), tiles in unloaded chunks read as 0
+    void copy_region(const util::AABBi &box, const glm::ivec3 &dst);
+
+    // calls f(chunk, box) for each loaded chunk intersecting box, with box
+    // clipped to and in the space of that chunk
+    template <typename F>
+    inline void for_each_chunk(const util::AABBi &box, F &&f) {
+        const auto
+            o_min = Area::to_offset(box.min),
+            o_max = Area::to_offset(box.max);
+
+        for (int x = o_min.x; x <= o_max.x; x++) {
+            for (int z = o_min.z; z <= o_max.z; z++) {
+                for (int y = o_min.y; y <= o_max.y; y++) {
+                    auto *chunk = this->chunkp(glm::ivec3(x, y, z));
+                    if (!chunk) {
+                        continue;
+                    }
+
+                    const auto local =
+                        Chunk::clamp(box.translate(-chunk->offset_tiles));
+                    if (local) {
+                        f(*chunk, *local);
+                    }
+                }
+            }
+        }
+    }
+
     // returns true if the area contains the chunk at the specified offset
     // AND it is loaded in (present in the area)
     inline bool contains_chunk(const glm::ivec3 &offset) {
-        return this->chunks.contains(offset);
+        return this->chunks.get(offset) != nullptr;
     }
 
     // get a raw chunk pointer
     inline Chunk *chunkp(const glm::ivec3 &offset) {
-        return
-            this->chunks.contains(offset) ?
-                this->chunks[offset].get() :
-                nullptr;
+        return this->chunks.get(offset);
+    }
+
+    // chunk of level at offset, level 0 being the area's own chunks
+    // nullptr if not present
+    inline Chunk *lodp(usize level, const glm::ivec3 &offset) {
+        return level == 0 ?
+            this->chunks.get(offset) : this->lods[level - 1].get(offset);
+    }
+
+    // radius (in the area's chunks) around center covered by level
+    inline usize lod_radius(usize level) const {
+        return this->radius << level;
+    }
+
+    // inclusive range of offsets of level's chunks within its radius
+    inline std::pair<glm::ivec3, glm::ivec3> lod_range(usize level) const {
+        const int r = this->lod_radius(level);
+        const auto c = Area::to_offset(this->center);
+        return {
+            Area::to_lod_offset(c - glm::ivec3(r, 0, r), level),
+            Area::to_lod_offset(c + glm::ivec3(r, 0, r), level)
+        };
+    }
+
+    // true if the chunk of level (from 1) at offset is well within the
+    // radius of the level below, which draws it instead once loaded
+    inline bool lod_inner(usize level, const glm::ivec3 &offset) const {
+        const int size = 1 << level;
+        const auto
+            lo = (offset * size) - Area::to_offset(this->center),
+            hi = lo + (size - 1);
+        const int distance =
+            glm::max(
+                glm::max(glm::abs(lo.x), glm::abs(hi.x)),
+                glm::max(glm::abs(lo.z), glm::abs(hi.z)));
+        return distance
+            <= static_cast<int>(this->lod_radius(level - 1))
+                - (LOD_INNER_MARGIN << (level - 1));
     }
 
     // get a raw chunk reference (crashes if chunk is not present!)
     inline Chunk &chunk(const glm::ivec3 &offset) {
-        return *this->chunks[offset].get();
+        return *this->chunks.get(offset);
     }
 
     // raw chunk data access via area offset
-    inline auto operator[](const glm::ivec3 &pos) {
-        auto *chunk = this->chunks[Area::to_offset(pos)].get();
+    inline Chunk::Data operator[](const glm::ivec3 &pos) {
+        auto *chunk = this->chunks.get(Area::to_offset(pos));
         return chunk ? (*chunk)[Area::to_chunk_pos(pos)] : 0;
     }
 
+    // height of column xz (area space), y of its highest tile + 1, 0 if the
+    // column is empty or its chunk is not loaded
+    inline int height(Chunk::Heightmap map, const glm::ivec2 &xz) {
+        const auto pos = glm::ivec3(xz.x, 0, xz.y);
+        auto *chunk = this->chunks.get(Area::to_offset(pos));
+        return chunk ? chunk->height(map, Area::to_chunk_pos(pos).xz()) : 0;
+    }
+
+    // y of the highest tile in column xz (area space), nullopt if the column
+    // is empty or its chunk is not loaded
+    inline std::optional<int> highest(
+        Chunk::Heightmap map, const glm::ivec2 &xz) {
+        const int h = this->height(map, xz);
+        return h == 0 ? std::nullopt : std::make_optional(h - 1);
+    }
+
     // utility functions
     // area pos to chunk pos
     static inline glm::ivec3 to_chunk_pos(glm::ivec3 pos_a) {
@@ -91,26 +340,169 @@ struct Area final
 
     // area pos to chunk offset
     static inline glm::ivec3 to_offset(const glm::ivec3 &pos_a) {
-        return glm::floor(glm::vec3(pos_a) / glm::vec3(Chunk::SIZE));
+        return glm::ivec3(
+            util::floor_div(pos_a.x, Chunk::SIZE.x),
+            util::floor_div(pos_a.y, Chunk::SIZE.y),
+            util::floor_div(pos_a.z, Chunk::SIZE.z));
     }
 
     // float to tile pos
     static inline glm::ivec3 to_tile(const glm::vec3 &pos_f) {
         return glm::floor(pos_f);
     }
+
+    // chunk offset to offset of the chunk of level containing it
+    static inline glm::ivec3 to_lod_offset(
+        const glm::ivec3 &offset, usize level) {
+        const int size = 1 << level;
+        return glm::ivec3(
+            util::floor_div(offset.x, size),
+            0,
+            util::floor_div(offset.z, size));
+    }
+
+private:
+    // loads/unloads/generates downsampled chunks, part of tick()
+    void tick_lods();
+
+    // downsampled chunks being generated on jobs
+    usize lod_jobs() const;
+
+    // true if the columns of the chunk of level at offset are loaded, by it
+    // or (for inner chunks) by the levels below
+    bool lod_loaded(usize level, const glm::ivec3 &offset);
 };
 
 struct AreaRenderer final {
     Area &area;
-    std::unordered_map<glm::ivec3, std::unique_ptr<ChunkRenderer>>
+
+    // vertices of every chunk renderer's mesh, must be declared before
+    // renderer_pool
+    gfx::GeometryPool geometry;
+
+    // renderers are recycled with their CPU-side storage, must be declared
+    // before chunk_renderers
+    util::Pool<ChunkRenderer, true> renderer_pool;
+
+    std::unordered_map<glm::ivec3, util::Pool<ChunkRenderer, true>::Ptr>
         chunk_renderers;
 
-    explicit AreaRenderer(Area &area)
-        : area(area) { }
+    // renderers of the area's downsampled chunks, by level (from 1)
+    std::array<
+        std::unordered_map<
+            glm::ivec3, util::Pool<ChunkRenderer, true>::Ptr>,
+        Area::LOD_LEVELS> lod_renderers;
+
+    // downsampled chunks drawn as their (2 x 2) chunks of the level below
+    // instead, which they are once all of those are meshed and within the
+    // radius of the level below, minus LOD_HYSTERESIS of its chunks so that
+    // chunks on the edge do not switch back and forth as center moves
+    std::array<std::unordered_set<glm::ivec3>, Area::LOD_LEVELS> refined;
+    static constexpr int LOD_HYSTERESIS = 2;
+    static_assert(Area::LOD_INNER_MARGIN > LOD_HYSTERESIS);
+
+    // downsampled chunks drawn this frame, and the area's chunks which they
+    // cover and which are not drawn
+    std::vector<ChunkRenderer*> lod_drawn;
+    std::unordered_set<glm::ivec3> covered;
 
+    // mesher for all chunk renderers, can be changed at any time
+    ChunkRenderer::Mesher mesher;
+
+    // meshing jobs (on state.jobs), mesh_threads is the max. number of jobs
+    // in flight from [gfx] mesh_threads, 0 (or no workers) meshes on the
+    // main thread
+    usize mesh_threads;
+    std::vector<util::Jobs::Handle> mesh_jobs;
+
+    // totals over all chunk renderers
+    struct Stats {
+        usize vertices, quads, gpu_bytes;
+    };
+
+    // mesh bytes handed to bgfx by update(), copied and by reference (see
+    // ChunkRenderer::vertex_refs), in the last frame and in all frames
+    struct UploadStats {
+        usize copied = 0, referenced = 0;
+    };
+    UploadStats last_uploads, uploads;
+
+    // culling counters of a view: frustum tests (quadtree nodes and chunks),
+    // chunks which were not submitted (outside of the frustum or empty) and
+    // chunks which were, sections submitted, non-empty sections of
+    // submitted chunks which cave culling hid and sections which occlusion
+    // culling hid
+    struct CullStats {
+        usize tested, culled, submitted, sections, hidden, occluded;
+    };
+
+    // chunk and mask of its sections to draw (see ChunkRenderer::render)
+    struct Visible {
+        ChunkRenderer *renderer;
+        u8 sections;
+    };
+
+    // chunks visible from a view, culled on the first render() of that view
+    // each frame
+    struct View {
+        bool valid = false;
+        CullStats stats;
+
+        // front to back
+        std::vector<Visible> visible;
+
+        // cave culling's search queue and mask of sections it reached per
+        // chunk of the area, kept so that culling does not allocate
+        std::vector<SectionNode> queue;
+        std::vector<u8> reached;
+    };
+
+    std::unordered_map<bgfx::ViewId, View> views;
+
+    // hide sections which cannot be seen from a perspective camera's section
+    // through see-through tiles, from [gfx] cave_culling
+    bool cave_culling;
+
+    // hide sections behind the occluders (see SectionOccluders) of the
+    // nearest chunks in a perspective camera's view, from
+    // [gfx] occlusion_culling
+    bool occlusion_culling;
+
+    // hand meshes to bgfx without copying them, from [gfx] zero_copy_upload
+    bool zero_copy_upload;
+
+    // closest visible chunks whose occluders are rasterized
+    static constexpr usize OCCLUDER_CHUNKS = 32;
+
+    // reused for every view
+    util::OcclusionBuffer occlusion;
+
+    explicit AreaRenderer(Area &area);
+    ~AreaRenderer();
+
+    Stats stats() const;
+
+    // logs levels of detail drawn, meshes, the geometry pool, uploads, the
+    // last cull of every view and the renderer pool
+    void debug_stats() const;
+
+    // keeps a renderer for every chunk (and downsampled chunk), uploads
+    // finished meshes, starts meshing changed chunks and selects the level
+    // of detail drawn everywhere, once per frame before any render()
+    void update();
+
+    // renders chunks in the frustum of camera, opaque passes front to back
+    // and others back to front
     void render(
         Tile::RenderPass render_pass,
+        const util::Camera &camera,
         bgfx::ViewId view = 0, u64 render_state = 0);
+
+private:
+    void cull(const util::Camera &camera, View &view);
+
+    // updates refined, lod_drawn and covered
+    void select_lods();
 };
 }
 
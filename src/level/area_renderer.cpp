@@ -1,33 +1,561 @@
 #include "level/area.hpp"
+#include "state.hpp"
 
 using namespace level;
 
-void AreaRenderer::render(
-    Tile::RenderPass render_pass,
-    bgfx::ViewId view, u64 render_state) {
-    // ensure all chunks have renderers, get rid of those that are no longer
-    // valid
-    for (auto it = this->chunk_renderers.begin();
-         it != this->chunk_renderers.end();) {
-        auto &[offset, _] = *it;
+AreaRenderer::AreaRenderer(Area &area)
+    : area(area),
+      geometry(
+          ChunkRenderer::ChunkVertex::layout,
+          std::clamp<i64>(
+              state.platform.settings["gfx"]["geometry_page_vertices"]
+                  .value_or(gfx::GeometryPool::DEFAULT_PAGE_VERTICES),
+              ChunkRenderer::MAX_SECTION_RANGE,
+              std::numeric_limits<u32>::max())) {
+    this->mesher =
+        state.platform.settings["gfx"]["greedy_meshing"].value_or(false) ?
+            ChunkRenderer::GREEDY
+            : ChunkRenderer::PER_FACE;
+    this->cave_culling =
+        state.platform.settings["gfx"]["cave_culling"].value_or(true);
+    this->occlusion_culling =
+        state.platform.settings["gfx"]["occlusion_culling"].value_or(true);
+    this->mesh_threads =
+        std::max<i64>(
+            state.platform.settings["gfx"]["mesh_threads"].value_or(2), 0);
+    this->zero_copy_upload =
+        state.platform.settings["gfx"]["zero_copy_upload"].value_or(true);
+}
+
+AreaRenderer::~AreaRenderer() {
+    // jobs only touch their own builds, but those may outlive the area
+    for (const auto &job : this->mesh_jobs) {
+        state.jobs.wait(job);
+    }
+}
+
+AreaRenderer::Stats AreaRenderer::stats() const {
+    Stats stats = { 0, 0, 0 };
+    const auto add = [&](const auto &renderers) {
+        for (const auto &[_, renderer] : renderers) {
+            stats.vertices += renderer->num_vertices();
+            stats.quads += renderer->num_quads();
+            stats.gpu_bytes += renderer->gpu_bytes();
+        }
+    };
+
+    add(this->chunk_renderers);
+    for (const auto &renderers : this->lod_renderers) {
+        add(renderers);
+    }
+
+    return stats;
+}
+
+void AreaRenderer::debug_stats() const {
+    for (usize level = 1; level <= this->area.lod_levels; level++) {
+        util::log::out()
+            << "lod " << level << ": "
+            << this->refined[level - 1].size() << " refined"
+            << util::log::end;
+    }
+
+    if (this->area.lod_levels > 0) {
+        util::log::out()
+            << "lod: " << this->lod_drawn.size() << " drawn, "
+            << this->covered.size() << " chunks covered"
+            << util::log::end;
+    }
+
+    const auto mesh = this->stats();
+    util::log::out()
+        << "meshes ("
+        << (this->mesher == ChunkRenderer::GREEDY ? "greedy" : "per face")
+        << "): " << mesh.vertices << " vertices, "
+        << mesh.quads << " quads, "
+        << (mesh.gpu_bytes / 1024) << " KiB GPU, "
+        << (state.renderer.quad_indices->bytes() / 1024)
+        << " KiB shared quad indices"
+        << util::log::end;
+
+    const auto geometry = this->geometry.stats();
+    util::log::out()
+        << "geometry pool: " << geometry.pages << " pages, "
+        << ((geometry.used * sizeof(ChunkRenderer::ChunkVertex)) / 1024)
+        << "/"
+        << ((geometry.capacity * sizeof(ChunkRenderer::ChunkVertex)) / 1024)
+        << " KiB, "
+        << std::fixed << std::setprecision(1)
+        << (geometry.utilization() * 100.0) << "% utilization, "
+        << (geometry.fragmentation() * 100.0) << "% fragmentation ("
+        << geometry.free_ranges << " free ranges)"
+        << util::log::end;
+
+    // mesh bytes copied on their way to bgfx, and referenced instead
+    const auto &uploads = this->uploads;
+    const auto frames = std::max<u64>(state.time.frames, 1);
+    util::log::out()
+        << "uploads ("
+        << (this->zero_copy_upload ? "zero copy" : "copy")
+        << "): " << (this->last_uploads.copied / 1024)
+        << " KiB copied last frame, "
+        << ((uploads.copied / frames) / 1024) << " KiB/frame copied, "
+        << ((uploads.referenced / frames) / 1024) << " KiB/frame referenced, "
+        << ChunkRenderer::vertex_refs.in_flight() << " in flight, "
+        << ChunkRenderer::vertex_refs.grown << " grown"
+        << util::log::end;
+
+    // mesh size per chunk in the packed vertex format and in the previous
+    // all-float one with its own 32-bit indices
+    const auto n = std::max<usize>(this->chunk_renderers.size(), 1);
+    const usize index_bytes = mesh.quads * 6 * sizeof(u32);
+    util::log::out()
+        << "mesh per chunk: "
+        << ((mesh.vertices * sizeof(ChunkRenderer::ChunkVertex)) / n)
+        << " B packed, "
+        << ((mesh.vertices * ChunkRenderer::ChunkVertex::UNPACKED_SIZE
+                + index_bytes) / n) << " B unpacked"
+        << util::log::end;
+
+    for (const auto &[id, view] : this->views) {
+        util::log::out()
+            << "view " << id << ": "
+            << view.stats.tested << " tested, "
+            << view.stats.culled << " culled, "
+            << view.stats.submitted << " submitted, "
+            << view.stats.sections << " sections, "
+            << view.stats.hidden << " hidden by cave culling, "
+            << view.stats.occluded << " occluded"
+            << util::log::end;
+    }
+
+    this->renderer_pool.stats.debug_stats("renderer");
+}
+
+void AreaRenderer::update() {
+    // ensure all chunks of every level have renderers, get rid of those
+    // that are no longer valid
+    const auto maintain = [&](auto &renderers, usize level) {
+        for (auto it = renderers.begin(); it != renderers.end();) {
+            auto &[offset, renderer] = *it;
+
+            // chunk may also have been unloaded and reloaded at the same
+            // offset
+            // its ranges go back to the geometry pool right away rather
+            // than when it is recycled
+            if (this->area.lodp(level, offset) != renderer->chunk) {
+                renderer->release();
+                renderers.erase(it++);
+            } else {
+                it++;
+            }
+        }
+
+        const auto &chunks =
+            level == 0 ? this->area.chunks : this->area.lods[level - 1];
+        for (auto *chunk : chunks) {
+            if (!renderers.contains(chunk->offset)) {
+                renderers[chunk->offset] =
+                    this->renderer_pool.make(*chunk, this->geometry);
+            }
+        }
+    };
+
+    maintain(this->chunk_renderers, 0);
+    for (usize level = 1; level <= Area::LOD_LEVELS; level++) {
+        maintain(this->lod_renderers[level - 1], level);
+    }
+
+    // renderers may have changed, views are culled again
+    for (auto &[_, view] : this->views) {
+        view.valid = false;
+    }
+
+    // upload finished meshes, keep up to mesh_threads jobs meshing, the
+    // area's own chunks first
+    const bool async = this->mesh_threads > 0 && state.jobs.size() > 0;
+    std::erase_if(this->mesh_jobs, util::Jobs::done);
+
+    auto &refs = ChunkRenderer::vertex_refs;
+    refs.zero_copy = this->zero_copy_upload;
+    const auto copied = refs.copied, referenced = refs.referenced;
+
+    const auto mesh = [&](auto &renderers) {
+        for (auto &[_, renderer] : renderers) {
+            renderer->set_mesher(this->mesher);
 
-        if (!this->area.contains_chunk(offset)) {
-            this->chunk_renderers.erase(it++);
-        } else {
-            it++;
+            auto job =
+                renderer->update(
+                    async,
+                    this->mesh_jobs.size() < this->mesh_threads || !async);
+
+            if (job) {
+                this->mesh_jobs.push_back(std::move(job));
+            }
         }
+    };
+
+    mesh(this->chunk_renderers);
+    for (auto &renderers : this->lod_renderers) {
+        mesh(renderers);
     }
 
-    for (auto &[offset, chunk] : this->area.chunks) {
-        if (!this->chunk_renderers.contains(offset)) {
-            this->chunk_renderers[offset] =
-                std::make_unique<ChunkRenderer>(
-                    level::ChunkRenderer(*chunk.get()));
+    this->last_uploads = {
+        refs.copied - copied,
+        refs.referenced - referenced
+    };
+    this->uploads.copied += this->last_uploads.copied;
+    this->uploads.referenced += this->last_uploads.referenced;
+
+    this->select_lods();
+}
+
+void AreaRenderer::select_lods() {
+    this->lod_drawn.clear();
+    this->covered.clear();
+
+    const usize levels = this->area.lod_levels;
+    if (levels == 0) {
+        return;
+    }
+
+    const auto center = Area::to_offset(this->area.center);
+
+    // renderer of the chunk of level at offset if it has been meshed
+    const auto meshed =
+        [&](usize level, const glm::ivec3 &offset) -> ChunkRenderer* {
+            const auto &renderers =
+                level == 0 ?
+                    this->chunk_renderers : this->lod_renderers[level - 1];
+            const auto it = renderers.find(offset);
+            return it != renderers.end() && it->second->meshed() ?
+                it->second.get() : nullptr;
+        };
+
+    for (usize level = 1; level <= levels; level++) {
+        auto &refined = this->refined[level - 1];
+        const int
+            size = 1 << level,
+            radius = this->area.lod_radius(level - 1),
+            hysteresis = LOD_HYSTERESIS << (level - 1);
+
+        std::unordered_set<glm::ivec3> next;
+        for (const auto &[offset, _] : this->lod_renderers[level - 1]) {
+            // distance (in the area's chunks, on either axis) from center to
+            // the farthest chunk this chunk covers
+            const auto
+                lo = (offset * size) - center,
+                hi = lo + (size - 1);
+            const int distance =
+                glm::max(
+                    glm::max(glm::abs(lo.x), glm::abs(hi.x)),
+                    glm::max(glm::abs(lo.z), glm::abs(hi.z)));
+
+            const int limit =
+                refined.contains(offset) ? radius : radius - hysteresis;
+            if (distance > limit) {
+                continue;
+            }
+
+            bool ready = true;
+            for (int x = 0; x < 2; x++) {
+                for (int z = 0; z < 2; z++) {
+                    ready &=
+                        meshed(level - 1, (offset * 2) + glm::ivec3(x, 0, z))
+                            != nullptr;
+                }
+            }
+
+            if (ready) {
+                next.insert(offset);
+            }
         }
+
+        refined = std::move(next);
     }
 
-    // TODO: frustum culling
-    for (auto &[_, renderer] : this->chunk_renderers) {
-        renderer->render(render_pass, view, render_state);
+    // draws the coarsest meshed level which is not refined, falling back to
+    // finer levels where chunks are still missing
+    const auto area_range = this->area.lod_range(0);
+    const std::function<void(usize, glm::ivec3)> visit =
+        [&](usize level, glm::ivec3 offset) {
+            if (level == 0) {
+                return;
+            }
+
+            auto *renderer = meshed(level, offset);
+            if (renderer && !this->refined[level - 1].contains(offset)) {
+                this->lod_drawn.push_back(renderer);
+
+                // area chunks underneath
+                const int size = 1 << level;
+                const auto
+                    lo = glm::max(offset * size, area_range.first),
+                    hi =
+                        glm::min(
+                            (offset * size) + (size - 1),
+                            area_range.second);
+
+                for (int x = lo.x; x <= hi.x; x++) {
+                    for (int z = lo.z; z <= hi.z; z++) {
+                        this->covered.insert(glm::ivec3(x, 0, z));
+                    }
+                }
+                return;
+            }
+
+            for (int x = 0; x < 2; x++) {
+                for (int z = 0; z < 2; z++) {
+                    visit(level - 1, (offset * 2) + glm::ivec3(x, 0, z));
+                }
+            }
+        };
+
+    const auto [min, max] = this->area.lod_range(levels);
+    for (int x = min.x; x <= max.x; x++) {
+        for (int z = min.z; z <= max.z; z++) {
+            visit(levels, glm::ivec3(x, 0, z));
+        }
+    }
+}
+
+void AreaRenderer::cull(const util::Camera &camera, View &view) {
+    const auto frustum = camera.frustum();
+
+    view.stats = { 0, 0, 0, 0, 0, 0 };
+    view.visible.clear();
+
+    // adds renderer if it has anything to draw, optionally after testing its
+    // own bounds, unless a downsampled chunk is drawn in its place
+    const auto add = [&](const glm::ivec3 &offset, bool test) {
+        const auto it = this->chunk_renderers.find(offset);
+        if (it == this->chunk_renderers.end()
+                || this->covered.contains(offset)) {
+            return;
+        }
+
+        auto &renderer = *it->second;
+        const auto aabb = renderer.aabb();
+        if (!aabb) {
+            return;
+        }
+
+        if (test) {
+            view.stats.tested++;
+
+            if (!frustum.contains(*aabb)) {
+                return;
+            }
+        }
+
+        view.visible.push_back({ &renderer, renderer.nonempty() });
+    };
+
+    // quadtree over chunk columns: nodes entirely outside are skipped and
+    // nodes entirely inside are added without testing any of their chunks
+    const std::function<void(glm::ivec3, int)> node =
+        [&](glm::ivec3 min, int size) {
+            if (size == 1) {
+                add(min, true);
+                return;
+            }
+
+            view.stats.tested++;
+            const auto result =
+                frustum.test(
+                    util::AABB(
+                        glm::vec3(min * Chunk::SIZE),
+                        glm::vec3((min + glm::ivec3(size, 1, size))
+                            * Chunk::SIZE)));
+
+            if (result == util::Frustum::OUTSIDE) {
+                return;
+            } else if (result == util::Frustum::INSIDE) {
+                for (int x = 0; x < size; x++) {
+                    for (int z = 0; z < size; z++) {
+                        add(min + glm::ivec3(x, 0, z), false);
+                    }
+                }
+                return;
+            }
+
+            const int half = size / 2;
+            for (const auto &child : {
+                    glm::ivec3(0, 0, 0), glm::ivec3(half, 0, 0),
+                    glm::ivec3(0, 0, half), glm::ivec3(half, 0, half) }) {
+                node(min + child, half);
+            }
+        };
+
+    // root covers every chunk within the area's radius, chunks are only
+    // ever loaded at y = 0 (so that nodes span [0, Chunk::SIZE.y)) wherever
+    // the camera is
+    const int
+        radius = this->area.radius,
+        size = std::bit_ceil(static_cast<usize>((radius * 2) + 1));
+    auto root = Area::to_offset(this->area.center);
+    root.y = 0;
+    node(root - glm::ivec3(radius, 0, radius), size);
+
+    // cave culling, only meaningful from a point (and not for the sun)
+    const auto *perspective =
+        dynamic_cast<const util::PerspectiveCamera*>(&camera);
+
+    if (this->cave_culling && perspective) {
+        // sections reached per chunk of the area, outside of it is unloaded
+        const auto [min, max] = this->area.lod_range(0);
+        const auto extent = (max - min) + 1;
+        const auto index =
+            [&](const glm::ivec3 &offset) -> std::optional<usize> {
+                const auto p = offset - min;
+                if (p.x < 0 || p.z < 0 || p.x >= extent.x || p.z >= extent.z) {
+                    return std::nullopt;
+                }
+                return (p.x * extent.z) + p.z;
+            };
+
+        view.reached.assign(extent.x * extent.z, 0);
+
+        const bool culled =
+            visible_sections(
+                perspective->position,
+                frustum,
+                [&](const glm::ivec3 &offset, usize s)
+                    -> const SectionVisibility* {
+                    if (!index(offset)) {
+                        return nullptr;
+                    }
+
+                    const auto it = this->chunk_renderers.find(offset);
+                    return it == this->chunk_renderers.end() ?
+                        nullptr : &it->second->sections[s].visibility;
+                },
+                [&](const glm::ivec3 &offset, usize s) {
+                    u8 &mask = view.reached[*index(offset)];
+                    if (mask & (1 << s)) {
+                        return false;
+                    }
+
+                    mask |= 1 << s;
+                    return true;
+                },
+                view.queue);
+
+        // camera outside of loaded sections, nothing is hidden
+        if (culled) {
+            for (auto &v : view.visible) {
+                const auto i = index(v.renderer->chunk->offset);
+                const u8 mask = v.sections & (i ? view.reached[*i] : 0);
+                view.stats.hidden += std::popcount<u8>(v.sections & ~mask);
+                v.sections = mask;
+            }
+
+            std::erase_if(
+                view.visible,
+                [](const auto &v) { return v.sections == 0; });
+        }
+    }
+
+    // downsampled chunks, after cave culling which only knows about the
+    // area's own chunks, and sorted along with them
+    for (auto *renderer : this->lod_drawn) {
+        view.stats.tested++;
+
+        const auto aabb = renderer->aabb();
+        if (aabb && frustum.contains(*aabb)) {
+            view.visible.push_back({ renderer, renderer->nonempty() });
+        }
+    }
+
+    // front to back along the view direction
+    const auto depth = [&](const Visible &v) {
+        const auto *chunk = v.renderer->chunk;
+        const auto center =
+            (glm::vec3(chunk->offset_tiles) + (glm::vec3(Chunk::SIZE) / 2.0f))
+                * static_cast<f32>(chunk->scale());
+        return -(camera.view * glm::vec4(center, 1.0f)).z;
+    };
+
+    std::sort(
+        view.visible.begin(), view.visible.end(),
+        [&](const auto &a, const auto &b) { return depth(a) < depth(b); });
+
+    // occlusion culling: rasterize the nearest chunks' occluders and test
+    // every section against them, also only from a point
+    if (this->occlusion_culling && perspective) {
+        auto &buffer = this->occlusion;
+        buffer.clear(camera.proj * camera.view);
+
+        // occluders are in tiles of the area, downsampled chunks have none
+        const usize n = std::min(view.visible.size(), OCCLUDER_CHUNKS);
+        for (usize i = 0; i < n; i++) {
+            const auto *renderer = view.visible[i].renderer;
+            if (renderer->chunk->lod > 0) {
+                continue;
+            }
+
+            for (usize s = 0; s < Chunk::SECTIONS; s++) {
+                const auto &occluders = renderer->sections[s].occluders;
+                const auto min = renderer->section_aabb(s).min;
+
+                for (usize j = 0; j < SectionOccluders::COUNT; j++) {
+                    if (const auto box = occluders.aabb(j, min)) {
+                        buffer.occluder(*box, perspective->position);
+                    }
+                }
+            }
+        }
+
+        for (auto &v : view.visible) {
+            for (usize s = 0; s < Chunk::SECTIONS; s++) {
+                if (!(v.sections & (1 << s))) {
+                    continue;
+                }
+
+                if (buffer.occluded(v.renderer->section_aabb(s))) {
+                    v.sections &= ~(1 << s);
+                    view.stats.occluded++;
+                }
+            }
+        }
+
+        std::erase_if(
+            view.visible,
+            [](const auto &v) { return v.sections == 0; });
+    }
+
+    for (const auto &v : view.visible) {
+        view.stats.sections += std::popcount(v.sections);
+    }
+
+    // chunks which could have been drawn
+    usize drawable = this->lod_drawn.size();
+    for (const auto &[offset, _] : this->chunk_renderers) {
+        drawable += !this->covered.contains(offset);
+    }
+
+    view.stats.submitted = view.visible.size();
+    view.stats.culled = drawable - view.visible.size();
+}
+
+void AreaRenderer::render(
+    Tile::RenderPass render_pass,
+    const util::Camera &camera,
+    bgfx::ViewId view, u64 render_state) {
+    auto &v = this->views[view];
+    if (!v.valid) {
+        this->cull(camera, v);
+        v.valid = true;
+    }
+
+    if (render_pass == Tile::DEFAULT) {
+        for (const auto &[renderer, sections] : v.visible) {
+            renderer->render(render_pass, view, render_state, sections);
+        }
+    } else {
+        for (auto it = v.visible.rbegin(); it != v.visible.rend(); it++) {
+            it->renderer->render(
+                render_pass, view, render_state, it->sections);
+        }
     }
 }
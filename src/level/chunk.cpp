@@ -1,5 +1,6 @@
 #include "level/chunk.hpp"
 #include "level/area.hpp"
+#include "state.hpp"
 
 using namespace level;
 
@@ -11,20 +12,527 @@ Chunk::Data Chunk::or_area(const glm::ivec3 &pos) {
     }
 }
 
-Chunk *Chunk::neighbor(util::Direction d) {
-    return this->area.chunkp(this->offset + static_cast<glm::ivec3>(d));
+void Chunk::snapshot(ChunkSnapshot &dst) const {
+    dst.area = &this->area;
+    dst.offset = this->offset;
+    dst.offset_tiles = this->offset_tiles;
+    dst.version = this->version;
+    dst.versions = this->versions;
+    dst.tiles.assign(ChunkSnapshot::VOLUME, 0);
+
+    for (usize s = 0; s < SECTIONS; s++) {
+        const auto u = this->uniform(s);
+        dst.uniform[s] =
+            u ? std::make_optional(TileData::from(*u)) : std::nullopt;
+    }
+
+    // copies box (chunk space of src) to box + delta in dst
+    const auto copy =
+        [&](const Chunk &src, const util::AABBi &box, const glm::ivec3 &delta) {
+            const int n = box.max.z - box.min.z + 1;
+
+            for (int x = box.min.x; x <= box.max.x; x++) {
+                for (int y = box.min.y; y <= box.max.y; y++) {
+                    const auto &section = src.sections[y / SECTION_SIZE.y];
+                    const auto pos = glm::ivec3(x, y, box.min.z);
+                    TileId *out = &dst[pos + delta];
+
+                    if (section.uniform()) {
+                        std::fill(
+                            out, out + n,
+                            TileData::from(section.palette[0]));
+                        continue;
+                    }
+
+                    const usize i = Chunk::section_index(pos);
+                    for (int z = 0; z < n; z++) {
+                        out[z] = TileData::from(section.get(i + z));
+                    }
+                }
+            }
+        };
+
+    copy(*this, util::AABBi(glm::ivec3(0), SIZE - 1), glm::ivec3(0));
+
+    // apron, neighbors' border tiles which touch this chunk
+    for (const util::Direction d : {
+            util::Direction::SOUTH, util::Direction::NORTH,
+            util::Direction::EAST, util::Direction::WEST }) {
+        const auto *neighbor = this->links[d];
+        if (!neighbor) {
+            continue;
+        }
+
+        const auto dv = static_cast<glm::ivec3>(d);
+        auto box = util::AABBi(glm::ivec3(0), SIZE - 1);
+
+        for (int a = 0; a < 3; a++) {
+            if (dv[a] > 0) {
+                box.max[a] = 0;
+            } else if (dv[a] < 0) {
+                box.min[a] = SIZE[a] - 1;
+            }
+        }
+
+        copy(*neighbor, box, dv * SIZE);
+    }
+
+    // downsampled chunks may be drawn next to chunks of another level which
+    // do not line up with them: empty the top of their neighbors' borders so
+    // that their border faces near the surface are always emitted, as skirts
+    // which cover the cracks
+    // water is left alone so that skirts stay under it
+    if (this->lod == 0) {
+        return;
+    }
+
+    const auto skirt = [&](int x, int z) {
+        int n = 0;
+        for (int y = SIZE.y - 1; y >= 0 && n < SKIRT_DEPTH; y--) {
+            auto &tile = dst[glm::ivec3(x, y, z)];
+            if (tile != 0
+                    && state.tiles[tile].render_pass == Tile::DEFAULT) {
+                tile = 0;
+                n++;
+            }
+        }
+    };
+
+    for (int i = 0; i < SIZE.x; i++) {
+        skirt(-1, i);
+        skirt(SIZE.x, i);
+        skirt(i, -1);
+        skirt(i, SIZE.z);
+    }
 }
 
-std::array<Chunk*, 6> Chunk::neighbors() {
-    std::array<Chunk*, 6> res;
+SectionVisibility SectionVisibility::compute(
+    const ChunkSnapshot &snap, usize s) {
+    // see-through tiles: anything which does not hide everything behind it
+    const auto open = [](TileId id) {
+        const auto &t = state.tiles[id];
+        return t.transparency != Tile::Transparency::OFF
+            || t.render_pass != Tile::RenderPass::DEFAULT;
+    };
 
-    for (const util::Direction d : util::Direction::ALL) {
-        res[d] = this->neighbor(d);
+    if (const auto u = snap.uniform[s]) {
+        return { open(*u) ? ALL : 0 };
     }
 
-    return res;
+    constexpr auto size = Chunk::SECTION_SIZE;
+    constexpr usize volume = Chunk::SECTION_VOLUME;
+    const auto base = glm::ivec3(0, s * size.y, 0);
+
+    // local index in section is (x * size.y + y) * size.z + z
+    const auto to_pos = [&](usize i) {
+        return glm::ivec3(
+            i / (size.y * size.z), (i / size.z) % size.y, i % size.z);
+    };
+
+    const auto to_index = [&](const glm::ivec3 &p) {
+        return static_cast<usize>((p.x * size.y + p.y) * size.z + p.z);
+    };
+
+    std::array<bool, volume> visited = {};
+    std::array<u16, volume> stack;
+    SectionVisibility result = { 0 };
+
+    for (usize i = 0; i < volume; i++) {
+        if (visited[i] || !open(snap[base + to_pos(i)])) {
+            continue;
+        }
+
+        // faces touched by this connected region
+        u8 faces = 0;
+        usize top = 0;
+        stack[top++] = i;
+        visited[i] = true;
+
+        while (top > 0) {
+            const auto p = to_pos(stack[--top]);
+
+            for (const util::Direction d : util::Direction::ALL) {
+                const auto n = p + static_cast<glm::ivec3>(d);
+
+                if (glm::any(glm::lessThan(n, glm::ivec3(0)))
+                        || glm::any(glm::greaterThanEqual(n, size))) {
+                    faces |= 1 << d;
+                    continue;
+                }
+
+                const usize j = to_index(n);
+                if (!visited[j] && open(snap[base + n])) {
+                    visited[j] = true;
+                    stack[top++] = j;
+                }
+            }
+        }
+
+        for (usize a = 0; a < 6; a++) {
+            for (usize b = 0; b < 6; b++) {
+                if ((faces & (1 << a)) && (faces & (1 << b))) {
+                    result.bits |= 1ull << ((a * 6) + b);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+SectionOccluders SectionOccluders::compute(
+    const ChunkSnapshot &snap, usize s) {
+    // tiles which hide everything behind them
+    const auto opaque = [](TileId id) {
+        const auto &t = state.tiles[id];
+        return t.id != ID_AIR
+            && t.transparency == Tile::Transparency::OFF
+            && t.render_pass == Tile::RenderPass::DEFAULT;
+    };
+
+    constexpr auto size = Chunk::SECTION_SIZE;
+    constexpr int blocks_z = size.z / BLOCK;
+    const auto base = glm::ivec3(0, s * size.y, 0);
+
+    SectionOccluders result;
+
+    if (const auto u = snap.uniform[s]) {
+        const u8 hi = opaque(*u) ? size.y : 0;
+        result.runs.fill({ 0, hi });
+        return result;
+    }
+
+    for (usize i = 0; i < COUNT; i++) {
+        const auto column =
+            base + glm::ivec3((i / blocks_z) * BLOCK, 0, (i % blocks_z) * BLOCK);
+
+        Run best = { 0, 0 };
+        int start = 0;
+
+        for (int y = 0; y <= size.y; y++) {
+            bool solid = y < size.y;
+            for (usize x = 0; solid && x < BLOCK; x++) {
+                for (usize z = 0; solid && z < BLOCK; z++) {
+                    solid = opaque(snap[column + glm::ivec3(x, y, z)]);
+                }
+            }
+
+            if (solid) {
+                continue;
+            }
+
+            if (y - start > best.hi - best.lo) {
+                best = { static_cast<u8>(start), static_cast<u8>(y) };
+            }
+
+            start = y + 1;
+        }
+
+        result.runs[i] = best;
+    }
+
+    return result;
 }
 
 void Chunk::tick() {
 
 }
+
+bool Chunk::in_heightmap(Heightmap map, Data d) {
+    const auto &t = state.tiles[TileData::from(d)];
+
+    switch (map) {
+        case SOLID:
+            return t.id != ID_AIR;
+        case OPAQUE:
+            return t.id != ID_AIR
+                && t.transparency == Tile::Transparency::OFF
+                && t.render_pass == Tile::RenderPass::DEFAULT;
+        default:
+            util::_assert(false);
+            return false;
+    }
+}
+
+void Chunk::update_heightmaps(
+    const util::AABBi &box, std::optional<Data> d) {
+    for (int x = box.min.x; x <= box.max.x; x++) {
+        for (int z = box.min.z; z <= box.max.z; z++) {
+            this->update_heightmaps(
+                glm::ivec2(x, z), box.min.y, box.max.y, d);
+        }
+    }
+}
+
+// height of column xz considering only tiles at or below y
+static int scan_column(
+    const Chunk &chunk, Chunk::Heightmap map, const glm::ivec2 &xz, int y) {
+    while (y >= 0) {
+        const usize s = y / Chunk::SECTION_SIZE.y;
+
+        // skip entire uniform sections at once
+        if (const auto u = chunk.uniform(s)) {
+            if (Chunk::in_heightmap(map, *u)) {
+                return y + 1;
+            }
+
+            y = (s * Chunk::SECTION_SIZE.y) - 1;
+            continue;
+        }
+
+        if (Chunk::in_heightmap(
+                map, chunk.get(Chunk::index(glm::ivec3(xz.x, y, xz.y))))) {
+            return y + 1;
+        }
+
+        y--;
+    }
+
+    return 0;
+}
+
+void Chunk::update_heightmaps(const glm::ivec3 &pos, Data d) {
+    for (usize m = 0; m < Heightmap::COUNT; m++) {
+        const auto map = static_cast<Heightmap>(m);
+        auto &h = this->heightmaps[map][pos.x * SIZE.z + pos.z];
+
+        if (in_heightmap(map, d)) {
+            h = glm::max<int>(h, pos.y + 1);
+        } else if (h == pos.y + 1) {
+            // top tile was removed
+            h = scan_column(*this, map, pos.xz(), pos.y - 1);
+        }
+    }
+}
+
+void Chunk::update_heightmaps(
+    const glm::ivec2 &xz, int y_min, int y_max, std::optional<Data> d) {
+    for (usize m = 0; m < Heightmap::COUNT; m++) {
+        const auto map = static_cast<Heightmap>(m);
+        auto &h = this->heightmaps[map][xz.x * SIZE.z + xz.y];
+
+        if (h > y_max + 1) {
+            // top is above range and unchanged
+            continue;
+        } else if (d && in_heightmap(map, *d)) {
+            h = y_max + 1;
+        } else if (d) {
+            // range is now empty, only need to look below it
+            if (h >= y_min + 1) {
+                h = scan_column(*this, map, xz, y_min - 1);
+            }
+        } else {
+            h = scan_column(*this, map, xz, y_max);
+        }
+    }
+}
+
+void Chunk::dirty(const util::AABBi &box) {
+    this->dirty(box.min.y, box.max.y);
+
+    for (const auto d : util::Direction::ALL) {
+        auto *n = this->neighbor(d);
+        if (!n) {
+            continue;
+        }
+
+        bool touched;
+        switch (d) {
+            case util::Direction::SOUTH: touched = box.max.z == SIZE.z - 1; break;
+            case util::Direction::NORTH: touched = box.min.z == 0; break;
+            case util::Direction::EAST: touched = box.max.x == SIZE.x - 1; break;
+            case util::Direction::WEST: touched = box.min.x == 0; break;
+            case util::Direction::TOP: touched = box.max.y == SIZE.y - 1; break;
+            case util::Direction::BOTTOM: touched = box.min.y == 0; break;
+            default: touched = false; break;
+        }
+
+        if (touched) {
+            n->dirty(box.min.y, box.max.y);
+        }
+    }
+}
+
+// calls f(section, box) for each section intersecting box, with box clipped
+// to that section
+template <typename F>
+static inline void for_each_section(const util::AABBi &box, F &&f) {
+    const usize
+        s_min = box.min.y / Chunk::SECTION_SIZE.y,
+        s_max = box.max.y / Chunk::SECTION_SIZE.y;
+
+    for (usize s = s_min; s <= s_max; s++) {
+        const int base = s * Chunk::SECTION_SIZE.y;
+        f(s, util::AABBi(
+            glm::ivec3(
+                box.min.x,
+                glm::max<int>(box.min.y, base),
+                box.min.z),
+            glm::ivec3(
+                box.max.x,
+                glm::min<int>(box.max.y, base + Chunk::SECTION_SIZE.y - 1),
+                box.max.z)));
+    }
+}
+
+// true if box (already clipped to section) covers its entire section
+static inline bool covers_section(const util::AABBi &box) {
+    return box.max - box.min + 1 == Chunk::SECTION_SIZE;
+}
+
+void Chunk::fill(util::AABBi box, Data d) {
+    const auto clamped = Chunk::clamp(box);
+    if (!clamped) {
+        return;
+    }
+
+    for_each_section(*clamped, [&](usize s, const util::AABBi &b) {
+        auto &section = this->sections[s];
+
+        if (covers_section(b)) {
+            section.fill(d);
+            return;
+        }
+
+        // runs are contiguous along z
+        const usize len = b.max.z - b.min.z + 1;
+        for (int x = b.min.x; x <= b.max.x; x++) {
+            for (int y = b.min.y; y <= b.max.y; y++) {
+                const usize i =
+                    Chunk::section_index(glm::ivec3(x, y, b.min.z));
+                section.fill(i, i + len, d);
+            }
+        }
+    });
+
+    this->dirty(*clamped);
+    this->update_heightmaps(*clamped, d);
+}
+
+void Chunk::replace(util::AABBi box, Data from, Data to) {
+    const auto clamped = Chunk::clamp(box);
+    if (!clamped || from == to) {
+        return;
+    }
+
+    bool changed = false;
+
+    for_each_section(*clamped, [&](usize s, const util::AABBi &b) {
+        auto &section = this->sections[s];
+
+        // nothing to replace
+        if (!section.contains(from)) {
+            return;
+        }
+
+        const bool uniform = section.uniform();
+        changed = true;
+
+        if (uniform && covers_section(b)) {
+            section.fill(to);
+            return;
+        }
+
+        for (int x = b.min.x; x <= b.max.x; x++) {
+            for (int y = b.min.y; y <= b.max.y; y++) {
+                const usize i =
+                    Chunk::section_index(glm::ivec3(x, y, b.min.z));
+                const usize len = b.max.z - b.min.z + 1;
+
+                if (uniform) {
+                    section.fill(i, i + len, to);
+                    continue;
+                }
+
+                for (usize j = i; j < i + len; j++) {
+                    if (section.get(j) == from) {
+                        section.set(j, to);
+                    }
+                }
+            }
+        }
+    });
+
+    if (changed) {
+        this->dirty(*clamped);
+        this->update_heightmaps(*clamped);
+    }
+}
+
+void Chunk::copy_region(
+    const Chunk &src, util::AABBi box, glm::ivec3 dst) {
+    // clamp to both source and destination bounds
+    auto src_box = Chunk::clamp(box);
+    if (!src_box) {
+        return;
+    }
+
+    const auto dst_box =
+        Chunk::clamp(src_box->translate(dst - box.min));
+    if (!dst_box) {
+        return;
+    }
+
+    src_box = dst_box->translate(box.min - dst);
+
+    // whole, aligned sections can be copied as-is
+    if (covers_section(*src_box)
+            && src_box->min.y % SECTION_SIZE.y == 0
+            && dst_box->min.y % SECTION_SIZE.y == 0) {
+        this->sections[Chunk::section(dst_box->min)] =
+            src.sections[Chunk::section(src_box->min)];
+        this->dirty(*dst_box);
+        this->update_heightmaps(*dst_box);
+        return;
+    }
+
+    // go through a buffer as src and dst may overlap
+    const auto size = src_box->max - src_box->min + 1;
+    std::vector<Data> buf(size.x * size.y * size.z);
+    src.read(*src_box, *src_box, &buf[0]);
+    this->write(*dst_box, *dst_box, &buf[0]);
+}
+
+void Chunk::read(
+    const util::AABBi &box, const util::AABBi &buf_box, Data *buf) const {
+    const auto size = buf_box.max - buf_box.min + 1;
+
+    for (int x = box.min.x; x <= box.max.x; x++) {
+        for (int y = box.min.y; y <= box.max.y; y++) {
+            const auto &section =
+                this->sections[y / SECTION_SIZE.y];
+            const usize i = Chunk::section_index(glm::ivec3(x, y, box.min.z));
+
+            Data *out =
+                &buf[((x - buf_box.min.x) * size.y + (y - buf_box.min.y))
+                        * size.z + (box.min.z - buf_box.min.z)];
+
+            for (int z = 0; z <= box.max.z - box.min.z; z++) {
+                out[z] = section.get(i + z);
+            }
+        }
+    }
+}
+
+void Chunk::write(
+    const util::AABBi &box, const util::AABBi &buf_box, const Data *buf) {
+    const auto size = buf_box.max - buf_box.min + 1;
+
+    for (int x = box.min.x; x <= box.max.x; x++) {
+        for (int y = box.min.y; y <= box.max.y; y++) {
+            auto &section = this->sections[y / SECTION_SIZE.y];
+            const usize i = Chunk::section_index(glm::ivec3(x, y, box.min.z));
+
+            const Data *in =
+                &buf[((x - buf_box.min.x) * size.y + (y - buf_box.min.y))
+                        * size.z + (box.min.z - buf_box.min.z)];
+
+            for (int z = 0; z <= box.max.z - box.min.z; z++) {
+                section.set(i + z, in[z]);
+            }
+        }
+    }
+
+    this->dirty(box);
+    this->update_heightmaps(box);
+}
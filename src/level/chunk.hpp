@@ -12,43 +12,65 @@ namespace level {
 // forward declaration from area.hpp
 struct Area;
 
+// forward declaration
+struct ChunkSnapshot;
+
 struct Chunk final : util::Tickable {
     static constexpr const glm::ivec3 SIZE = glm::ivec3(16, 128, 16);
     static constexpr const usize VOLUME = SIZE.x * SIZE.y * SIZE.z;
 
+    // chunks are stored as a vertical stack of cubic sections
+    static constexpr const glm::ivec3 SECTION_SIZE = glm::ivec3(16);
+    static constexpr const usize
+        SECTION_VOLUME = SECTION_SIZE.x * SECTION_SIZE.y * SECTION_SIZE.z,
+        SECTIONS = SIZE.y / SECTION_SIZE.y;
+
     // chunk data type
     typedef u64 Data;
 
+    // size of chunk data if stored as a flat Data[VOLUME] array
+    static constexpr const usize FLAT_BYTES = VOLUME * sizeof(Data);
+
+    // heightmap types
+    enum Heightmap {
+        // any tile which is not air
+        SOLID = 0,
+
+        // tiles which block light: non-transparent, excluding water
+        OPAQUE = 1,
+
+        COUNT = (OPAQUE + 1)
+    };
+
     // proxy for access to chunk data
     template <typename T, usize O, usize M, usize S>
     struct ChunkDataAccess final {
         // proxy for access to individual element
         struct Proxy {
             ChunkDataAccess *parent;
-            Data *data;
+            usize index;
 
             Proxy(ChunkDataAccess *parent, const glm::ivec3 &p)
-                : Proxy(parent, p.x * SIZE.y * SIZE.z + p.y * SIZE.z + p.z) { }
+                : Proxy(parent, Chunk::index(p)) { }
 
             Proxy(ChunkDataAccess *parent, usize i)
-                : parent(parent),
-                  data(&(parent->chunk->data[i])) { }
-
-            Proxy(ChunkDataAccess *parent, Data *data)
-                : parent(parent), data(data) { }
+                : parent(parent), index(i) { }
 
-            // TODO: this is much slower than it should be due to null check
-            inline operator T() {
-                return static_cast<T>(((*this->data) & M) >> O);
+            inline operator T() const {
+                return from(this->parent->chunk->get(this->index));
             }
 
             inline Proxy &operator=(T value) {
-                // TODO: consider only doing this if value changes
-                this->parent->chunk->version++;
+                auto *chunk = this->parent->chunk;
+                const auto d = chunk->get(this->index), e = merge(d, value);
+
+                if (d != e) {
+                    const auto pos = Chunk::position(this->index);
+                    chunk->set(this->index, e);
+                    chunk->dirty(pos);
+                    chunk->update_heightmaps(pos, e);
+                }
 
-                *this->data =
-                    (*this->data & ~M)
-                    | ((static_cast<Data>(value) << O) & M);
                 return *this;
             }
         };
@@ -59,33 +81,32 @@ struct Chunk final : util::Tickable {
             Proxy p;
             glm::ivec3 pos;
 
-            SafeProxy(ChunkDataAccess *parent, Data *data)
-                : p(parent, data) { }
+            SafeProxy(ChunkDataAccess *parent, usize index)
+                : p(parent, index), pos(Chunk::position(index)) { }
             SafeProxy(ChunkDataAccess *parent, const glm::ivec3 &pos)
                 : p(parent, pos), pos(pos) { }
 
-            inline operator T() {
-                return this->p.data ? p : 0;
+            inline operator T() const {
+                return this->p.parent ? p : 0;
             }
 
             inline SafeProxy &operator=(T value) {
-                // TODO: consider only doing this if value changes
-                // update versions of neighboring chunks
-                auto border = Chunk::border(this->pos);
-                if (border) {
-                    auto *neighbor = this->p.parent->chunk->neighbor(*border);
-                    if (neighbor) {
-                        neighbor->version++;
-                    }
+                auto *chunk = this->p.parent->chunk;
+                const auto d = chunk->get(this->p.index), e = merge(d, value);
+
+                // also dirties neighboring chunks if on border
+                if (d != e) {
+                    chunk->set(this->p.index, e);
+                    chunk->dirty(util::AABBi(this->pos, this->pos));
+                    chunk->update_heightmaps(this->pos, e);
                 }
 
-                this->p = value;
                 return *this;
             }
         };
 
         // proxy which evaluates to zero and crashes on assignment
-        static const inline auto ZERO = SafeProxy(nullptr, nullptr);
+        static const inline auto ZERO = SafeProxy(nullptr, 0);
 
         Chunk *chunk;
 
@@ -110,17 +131,49 @@ struct Chunk final : util::Tickable {
         static inline T from(Data d) {
             return static_cast<T>((d & M) >> O);
         }
+
+        // d with this accessor's bits replaced by value
+        static inline Data merge(Data d, T value) {
+            return (d & ~M) | ((static_cast<Data>(value) << O) & M);
+        }
     };
 
-    std::array<Chunk::Data, Chunk::VOLUME> data;
+    // palette-compressed section data, a section with a single palette entry
+    // is uniformly that value (all air, all stone, etc.)
+    // access through RawData/TileData proxies
+    using Section = util::PaletteArray<Chunk::Data, Chunk::SECTION_VOLUME>;
+    std::array<Section, SECTIONS> sections;
 
     Area &area;
     glm::ivec3 offset, offset_tiles;
 
-    // arbitrary integer, *must* change every time chunk data is updated
+    // level of detail: 0 for the area's chunks, otherwise this is a
+    // downsampled chunk (see Area::lods) whose offset is in units of its own
+    // size and whose tiles each cover (scale() x scale() x scale()) tiles
+    u8 lod = 0;
+
+    // depth (in tiles of this chunk) below the surface of a downsampled
+    // chunk's neighbors to which their borders are treated as empty, see
+    // snapshot()
+    static constexpr int SKIRT_DEPTH = 2;
+
+    // neighboring chunks by util::Direction, maintained by the area's
+    // ChunkGrid, nullptr if not present
+    std::array<Chunk*, 6> links;
+
+    // arbitrary integers, *must* change every time chunk data is updated
     // used for tracking when chunk is dirtied by external things (primarily
     // the renderer)
+    // version changes on any update, versions[s] when section s (or a tile
+    // bordering it) changes, see Chunk::dirty
     u64 version;
+    std::array<u64, SECTIONS> versions;
+
+    // per-column height (y of the highest tile + 1, 0 if there is none) for
+    // each Heightmap type, indexed by x * SIZE.z + z
+    // kept up to date on every write through proxies or bulk operations,
+    // columns are only rescanned when their top tile is removed
+    std::array<std::array<u8, SIZE.x * SIZE.z>, Heightmap::COUNT> heightmaps;
 
     // data accessors
     // types are declared explicitly for easy use of their static methods
@@ -137,10 +190,12 @@ struct Chunk final : util::Tickable {
         : area(area),
           offset(offset),
           offset_tiles(offset * SIZE),
+          links({}),
+          version(0),
+          versions({}),
+          heightmaps({}),
           raw(this),
-          tiles(this) {
-        std::memset(&this->data, 0, sizeof(this->data));
-    }
+          tiles(this) { }
     Chunk(const Chunk &other) = default;
     Chunk(Chunk &&other) = default;
 
@@ -152,21 +207,202 @@ struct Chunk final : util::Tickable {
         return this->raw[p];
     }
 
+    // raw data access by index, does not update versions!
+    inline Data get(usize index) const {
+        return this->sections[index / SECTION_VOLUME]
+            .get(index % SECTION_VOLUME);
+    }
+
+    inline void set(usize index, Data d) {
+        this->sections[index / SECTION_VOLUME]
+            .set(index % SECTION_VOLUME, d);
+    }
+
+    // returns the value of every tile in the section if it is uniform
+    inline std::optional<Data> uniform(usize section) const {
+        const auto &s = this->sections[section];
+        return s.uniform() ? std::make_optional(s.palette[0]) : std::nullopt;
+    }
+
+    // true if section is entirely air
+    inline bool empty(usize section) const {
+        const auto u = this->uniform(section);
+        return u && TileData::from(*u) == 0;
+    }
+
+    // set an entire section to a single value
+    inline void fill_section(usize section, Data d) {
+        const int
+            y_min = section * SECTION_SIZE.y,
+            y_max = y_min + SECTION_SIZE.y - 1;
+
+        this->sections[section].fill(d);
+        this->dirty(y_min, y_max);
+
+        for (int x = 0; x < SIZE.x; x++) {
+            for (int z = 0; z < SIZE.z; z++) {
+                this->update_heightmaps(glm::ivec2(x, z), y_min, y_max, d);
+            }
+        }
+    }
+
+    // height of column xz, y of its highest tile + 1 (0 if empty)
+    inline int height(Heightmap map, const glm::ivec2 &xz) const {
+        return this->heightmaps[map][xz.x * SIZE.z + xz.y];
+    }
+
+    // y of the highest tile in column xz, nullopt if empty
+    inline std::optional<int> highest(
+        Heightmap map, const glm::ivec2 &xz) const {
+        const int h = this->height(map, xz);
+        return h == 0 ? std::nullopt : std::make_optional(h - 1);
+    }
+
+    // true if d counts towards heightmap map
+    static bool in_heightmap(Heightmap map, Data d);
+
+    // updates heightmaps after the tile at pos was set to d
+    void update_heightmaps(const glm::ivec3 &pos, Data d);
+
+    // updates heightmaps after column xz was written in [y_min, y_max], d is
+    // the value of the whole range if it was filled with a single value
+    void update_heightmaps(
+        const glm::ivec2 &xz, int y_min, int y_max,
+        std::optional<Data> d = std::nullopt);
+
+    // update_heightmaps for every column in box
+    void update_heightmaps(
+        const util::AABBi &box, std::optional<Data> d = std::nullopt);
+
+    // marks tiles in [y_min, y_max] dirty, also dirties vertically adjacent
+    // sections if the range touches their border
+    inline void dirty(int y_min, int y_max) {
+        const int
+            s_min = glm::max(y_min - 1, 0) / SECTION_SIZE.y,
+            s_max = glm::min(y_max + 1, SIZE.y - 1) / SECTION_SIZE.y;
+
+        for (int s = s_min; s <= s_max; s++) {
+            this->versions[s]++;
+        }
+
+        this->version++;
+    }
+
+    inline void dirty(const glm::ivec3 &pos) {
+        this->dirty(pos.y, pos.y);
+    }
+
+    // marks box dirty in this chunk and in any neighbors whose border it
+    // touches
+    void dirty(const util::AABBi &box);
+
+    // bulk operations on raw data, boxes are inclusive, in chunk space and
+    // clamped to chunk bounds
+    // these write runs directly and dirty this chunk (and any neighbor whose
+    // border is touched) only once
+    void fill(util::AABBi box, Data d);
+    void replace(util::AABBi box, Data from, Data to);
+
+    // copy box of src (in src space) to dst (min corner, in this chunk's
+    // space), src may be this chunk
+    void copy_region(const Chunk &src, util::AABBi box, glm::ivec3 dst);
+
+    // read/write box (in chunk space) to/from buf, which is laid out x-major
+    // (x, then y, then z) over buf_box, box must be contained in buf_box
+    void read(
+        const util::AABBi &box, const util::AABBi &buf_box, Data *buf) const;
+    void write(
+        const util::AABBi &box, const util::AABBi &buf_box, const Data *buf);
+
+    // tiles of the area covered by each tile of this chunk on every axis
+    inline int scale() const {
+        return 1 << this->lod;
+    }
+
     // retrieve neighbor in specified direction
     // returns nullptr if not present
-    Chunk *neighbor(util::Direction d);
+    inline Chunk *neighbor(util::Direction d) {
+        return this->links[d];
+    }
 
     // retrieves data at the specified position or gets it from this chunk's
     // area if out of bounds
     Data or_area(const glm::ivec3 &pos);
 
+    // copies this chunk's tiles and those of its neighbors' borders into
+    // dst, see ChunkSnapshot
+    void snapshot(ChunkSnapshot &dst) const;
+
     // retrieve all chunk neighbors
     // array entry is nullptr if not present
-    std::array<Chunk*, 6> neighbors();
+    inline const std::array<Chunk*, 6> &neighbors() {
+        return this->links;
+    }
 
     void tick() override;
 
+    // approximate memory used by this chunk
+    inline usize bytes() const {
+        usize n = sizeof(Chunk) - sizeof(this->sections);
+        for (const auto &s : this->sections) {
+            n += s.bytes();
+        }
+        return n;
+    }
+
+    // hash of all chunk data, equal for chunks with equal data regardless of
+    // how their sections are stored
+    inline u64 checksum() const {
+        u64 h = 0;
+        for (const auto &s : this->sections) {
+            for (usize i = 0; i < SECTION_VOLUME; i++) {
+                h = util::mix_hash(h ^ s.get(i));
+            }
+        }
+        return h;
+    }
+
     // utility functions
+    // clamps box to chunk bounds, nullopt if it does not intersect the chunk
+    static inline std::optional<util::AABBi> clamp(const util::AABBi &box) {
+        const auto
+            min = glm::max(box.min, glm::ivec3(0)),
+            max = glm::min(box.max, SIZE - 1);
+
+        if (min.x > max.x || min.y > max.y || min.z > max.z) {
+            return std::nullopt;
+        }
+
+        return util::AABBi(min, max);
+    }
+
+    // chunk pos to data index, indices are section-major
+    static inline usize index(const glm::ivec3 &pos) {
+        return (pos.y / SECTION_SIZE.y) * SECTION_VOLUME
+            + pos.x * SECTION_SIZE.y * SECTION_SIZE.z
+            + (pos.y % SECTION_SIZE.y) * SECTION_SIZE.z
+            + pos.z;
+    }
+
+    // index of pos within its section
+    static inline usize section_index(const glm::ivec3 &pos) {
+        return Chunk::index(pos) % SECTION_VOLUME;
+    }
+
+    // data index to chunk pos
+    static inline glm::ivec3 position(usize index) {
+        const usize s = index / SECTION_VOLUME, i = index % SECTION_VOLUME;
+        return glm::ivec3(
+            i / (SECTION_SIZE.y * SECTION_SIZE.z),
+            (s * SECTION_SIZE.y) + ((i / SECTION_SIZE.z) % SECTION_SIZE.y),
+            i % SECTION_SIZE.z);
+    }
+
+    // section index of chunk pos
+    static inline usize section(const glm::ivec3 &pos) {
+        return pos.y / SECTION_SIZE.y;
+    }
+
     static inline bool in_bounds(const glm::ivec3 &pos) {
         return pos.x >= 0
             && pos.y >= 0
@@ -206,14 +442,224 @@ struct Chunk final : util::Tickable {
     }
 };
 
+// copy of a chunk's tiles plus a 1 tile apron of its face neighbors' border
+// tiles (air where there is no neighbor, and above/below the world): enough
+// to mesh the chunk without reading any live chunk data, so a snapshot can be
+// meshed on another thread while its chunk keeps changing
+struct ChunkSnapshot {
+    static constexpr const glm::ivec3 SIZE =
+        glm::ivec3(Chunk::SIZE.x + 2, Chunk::SIZE.y + 2, Chunk::SIZE.z + 2);
+    static constexpr const usize VOLUME = SIZE.x * SIZE.y * SIZE.z;
+
+    // only passed through to tile callbacks (Tile::texture_offset)
+    Area *area;
+    glm::ivec3 offset, offset_tiles;
+
+    // chunk versions (Chunk::version, Chunk::versions) when captured
+    u64 version;
+    std::array<u64, Chunk::SECTIONS> versions;
+
+    // tile of each section of the chunk which is uniform, nullopt otherwise
+    std::array<std::optional<TileId>, Chunk::SECTIONS> uniform;
+
+    // laid out x-major (x, then y, then z) over [-1, Chunk::SIZE] on each
+    // axis, reused between snapshots
+    std::vector<TileId> tiles;
+
+    // index of pos (chunk space) in tiles
+    static inline usize index(const glm::ivec3 &pos) {
+        const auto p = pos + 1;
+        return (p.x * SIZE.y + p.y) * SIZE.z + p.z;
+    }
+
+    inline TileId operator[](const glm::ivec3 &pos) const {
+        return this->tiles[ChunkSnapshot::index(pos)];
+    }
+
+    inline TileId &operator[](const glm::ivec3 &pos) {
+        return this->tiles[ChunkSnapshot::index(pos)];
+    }
+};
+
+// which faces of a section are connected to each other through tiles which
+// can be seen through (air, transparent tiles, water), for cave culling
+struct SectionVisibility {
+    // bit (a * 6) + b is set if faces a and b (util::Direction) connect
+    u64 bits;
+
+    // every face connected, for sections which are empty or unknown
+    static constexpr u64 ALL = (1ull << 36) - 1;
+
+    inline bool connected(util::Direction a, util::Direction b) const {
+        return this->bits & (1ull << ((a * 6) + b));
+    }
+
+    // flood fills the see-through tiles of section s of snap
+    static SectionVisibility compute(const ChunkSnapshot &snap, usize s);
+};
+
+// solid boxes inside of a section which hide everything behind them, for
+// occlusion culling (see util::OcclusionBuffer)
+struct SectionOccluders {
+    // section is split into columns of BLOCK x BLOCK tiles
+    static constexpr usize BLOCK = 4;
+    static constexpr usize COUNT =
+        (Chunk::SECTION_SIZE.x / BLOCK) * (Chunk::SECTION_SIZE.z / BLOCK);
+
+    // per column, longest run of layers [lo, hi) (section space) in which
+    // every tile is opaque, empty if lo == hi
+    struct Run {
+        u8 lo, hi;
+    };
+
+    std::array<Run, COUNT> runs;
+
+    // box of column i (area space) in a section with its minimum at min,
+    // nullopt if the column has no run
+    inline std::optional<util::AABB> aabb(
+        usize i, const glm::vec3 &min) const {
+        const auto &run = this->runs[i];
+        if (run.lo == run.hi) {
+            return std::nullopt;
+        }
+
+        const auto lo =
+            min + glm::vec3(
+                (i / (Chunk::SECTION_SIZE.z / BLOCK)) * BLOCK,
+                run.lo,
+                (i % (Chunk::SECTION_SIZE.z / BLOCK)) * BLOCK);
+        return util::AABB(
+            lo, lo + glm::vec3(BLOCK, run.hi - run.lo, BLOCK));
+    }
+
+    // finds the runs of section s of snap
+    static SectionOccluders compute(const ChunkSnapshot &snap, usize s);
+};
+
+// section reached by visible_sections, kept by callers between searches so
+// that its queue does not allocate every time
+struct SectionNode {
+    // chunk offset on x/z, section index on y
+    glm::ivec3 pos;
+    const SectionVisibility *visibility;
+
+    // face entered through (util::Direction), -1 for the first section
+    int from;
+
+    // directions travelled to get here
+    u8 directions;
+};
+
+// BFS over sections from the one containing position (area space), crossing
+// only from one face of a section to another if they are connected, only
+// into sections in frustum and never back towards position
+// visibility(offset, s) returns section s of the chunk at offset, nullptr if
+// there is no such chunk, visit(offset, s) is called with every section that
+// is reached and returns false if it was already visited (which callers
+// track, visible_sections does not)
+// queue is cleared and used as the BFS queue
+// returns false without visiting anything if position is not in a section
+// visibility knows about
+template <typename F, typename G>
+bool visible_sections(
+    const glm::vec3 &position,
+    const util::Frustum &frustum,
+    F visibility,
+    G visit,
+    std::vector<SectionNode> &queue) {
+    // sections span whole chunks horizontally
+    static_assert(
+        Chunk::SIZE.x == Chunk::SECTION_SIZE.x
+            && Chunk::SIZE.z == Chunk::SECTION_SIZE.z);
+
+    const auto start =
+        glm::ivec3(glm::floor(position / glm::vec3(Chunk::SECTION_SIZE)));
+    if (start.y < 0 || start.y >= static_cast<int>(Chunk::SECTIONS)) {
+        return false;
+    }
+
+    const auto *v = visibility(glm::ivec3(start.x, 0, start.z), start.y);
+    if (!v) {
+        return false;
+    }
+
+    queue.clear();
+    queue.push_back({ start, v, -1, 0 });
+    visit(glm::ivec3(start.x, 0, start.z), start.y);
+
+    for (usize i = 0; i < queue.size(); i++) {
+        const auto node = queue[i];
+
+        for (const util::Direction d : util::Direction::ALL) {
+            // directions are in opposing pairs, d ^ 1 is the opposite of d
+            if ((node.directions & (1 << (d ^ 1)))
+                    || (node.from >= 0
+                        && !node.visibility->connected(node.from, d))) {
+                continue;
+            }
+
+            const auto pos = node.pos + static_cast<glm::ivec3>(d);
+            if (pos.y < 0 || pos.y >= static_cast<int>(Chunk::SECTIONS)) {
+                continue;
+            }
+
+            const auto min = glm::vec3(pos * Chunk::SECTION_SIZE);
+            if (!frustum.contains(
+                    util::AABB(min, min + glm::vec3(Chunk::SECTION_SIZE)))) {
+                continue;
+            }
+
+            const auto offset = glm::ivec3(pos.x, 0, pos.z);
+            const auto *n = visibility(offset, pos.y);
+            if (!n || !visit(offset, pos.y)) {
+                continue;
+            }
+
+            queue.push_back({
+                pos, n, static_cast<int>(d ^ 1),
+                static_cast<u8>(node.directions | (1 << d)) });
+        }
+    }
+
+    return true;
+}
+
 struct ChunkRenderer final {
+    // PER_FACE emits one quad per visible tile face, GREEDY merges coplanar
+    // faces of the same tile (and texture) into larger quads
+    enum Mesher {
+        PER_FACE = 0,
+        GREEDY = 1
+    };
+
+    // packed vertex, unpacked in the vertex shader
     struct ChunkVertex {
-        glm::vec3 pos;
-        glm::vec3 normal;
-        glm::vec2 uv;
-        glm::vec4 material;
+        // position in chunk space, face direction (util::Direction)
+        u8 x, y, z, face;
+
+        // uv in tiles (the texture repeats once per tile), atlas cell index
+        // (x + (y * ATLAS_SIZE)), material shininess
+        u8 u, v, texture, shininess;
+
+        // atlas cells per side
+        static constexpr usize ATLAS_SIZE = 16;
+
+        // size of the previous all-float vertex (position, normal, uv,
+        // material), for comparison
+        static constexpr usize UNPACKED_SIZE = (3 + 3 + 2 + 4) * sizeof(f32);
 
         ChunkVertex() = default;
+        ChunkVertex(
+            const glm::ivec3 &pos,
+            util::Direction face,
+            const glm::ivec2 &uv,
+            const glm::ivec2 &texture,
+            u8 shininess)
+            : x(pos.x), y(pos.y), z(pos.z),
+              face(face),
+              u(uv.x), v(uv.y),
+              texture(texture.x + (texture.y * ATLAS_SIZE)),
+              shininess(shininess) {}
 
         static void create_layout();
 
@@ -221,28 +667,199 @@ struct ChunkRenderer final {
         static bgfx::VertexLayout layout;
     };
 
-    Chunk &chunk;
+    static_assert(sizeof(ChunkVertex) == 8);
+
+    // per-section mesh, kept (but for its vertices, see upload) so that only
+    // dirty sections need to be re-meshed and re-uploaded
+    struct SectionMesh {
+        // most faces a section can have, every tile with all 6 visible
+        static constexpr usize MAX_FACES = Chunk::SECTION_VOLUME * 6;
 
-    // version of the chunk (Chunk::version) when it was last meshed
+        // version of the section (Chunk::versions) when it was last meshed
+        u64 version;
+
+        // all passes laid out one after another (as they are in the GPU
+        // buffer), each is a list of quads of 4 vertices which are drawn
+        // with the shared gfx::QuadIndices
+        // only filled in builds, uploaded vertices are handed to bgfx, and
+        // storage is kept between meshes
+        std::vector<ChunkVertex> vertices;
+        std::array<usize, Tile::RenderPass::COUNT> quads;
+
+        // which faces of the section see each other, see visible_sections
+        SectionVisibility visibility;
+
+        // solid boxes hiding what is behind them, see AreaRenderer::cull
+        SectionOccluders occluders;
+
+        // vertices allocated to this section in the geometry pool, at least
+        // as many as it has, empty if it has none
+        gfx::GeometryPool::Range range;
+
+        inline usize num_vertices() const {
+            return this->num_quads() * 4;
+        }
+
+        inline usize num_quads() const {
+            return this->quads_before(Tile::RenderPass::COUNT);
+        }
+
+        // quads of all passes before pass
+        inline usize quads_before(usize pass) const {
+            usize n = 0;
+            for (usize i = 0; i < pass; i++) {
+                n += this->quads[i];
+            }
+            return n;
+        }
+    };
+
+    // CPU-side meshes of a snapshot's dirty sections, built on a job (or
+    // inline) and then uploaded by the main thread in update()
+    struct Build {
+        ChunkSnapshot snapshot;
+        Mesher mesher;
+
+        // sections which were re-meshed, only their meshes are valid
+        std::array<bool, Chunk::SECTIONS> dirty;
+        std::array<SectionMesh, Chunk::SECTIONS> sections;
+    };
+
+    // geometry pool space reserved for a section mesh of n vertices, leaves
+    // room for edits to grow it without moving it to a new range
+    static constexpr usize with_slack(usize n) {
+        return n + (n / 2);
+    }
+
+    // largest range a section can take in the geometry pool, that is
+    // with_slack(SectionMesh::MAX_FACES * 4)
+    static constexpr usize MAX_SECTION_RANGE =
+        SectionMesh::MAX_FACES * 4 + (SectionMesh::MAX_FACES * 4) / 2;
+
+    Chunk *chunk;
+
+    // version of the chunk (Chunk::version) of the last uploaded build
     usize mesh_version;
 
-    util::RDUniqueResource<bgfx::DynamicIndexBufferHandle> index_buffer;
-    util::RDUniqueResource<bgfx::DynamicVertexBufferHandle> vertex_buffer;
+    // mesher used for all sections, see set_mesher
+    Mesher mesher = PER_FACE;
+
+    // true if every section must be re-meshed regardless of its version
+    bool invalidated = false;
 
-    // indices separate for default/water meshes
-    struct {
-        usize num_indices, indices_start;
-        usize num_vertices, vertices_start;
-    } pass_indices[Tile::RenderPass::COUNT];
+    std::array<SectionMesh, Chunk::SECTIONS> sections;
 
-    explicit ChunkRenderer(Chunk &chunk);
+    // latest build, shared with its job so that this renderer can be
+    // recycled while the job is still running, kept to reuse its storage
+    std::shared_ptr<Build> build;
+    util::Jobs::Handle build_job;
+
+    // true while build is being meshed and has not been uploaded
+    bool building = false;
+
+    // pool which sections' vertices are allocated in, must outlive this
+    gfx::GeometryPool *geometry;
+
+    // builds' vertices while bgfx uploads them, shared by all renderers
+    static gfx::RefPool<ChunkVertex> vertex_refs;
+
+    ChunkRenderer(Chunk &chunk, gfx::GeometryPool &geometry);
     ChunkRenderer(const ChunkRenderer &other) = delete;
-    ChunkRenderer(ChunkRenderer &&other) = default;
+    ChunkRenderer(ChunkRenderer &&other) = delete;
+    ~ChunkRenderer();
+
+    // reuse this renderer (and its CPU-side storage) for another chunk
+    void recycle(Chunk &chunk, gfx::GeometryPool &geometry);
+
+    // drops the current mesh and returns its ranges to the geometry pool
+    void release();
+
+    // switches mesher, re-meshes every section on the next render
+    void set_mesher(Mesher mesher);
+
+    // uploads the current build if it is done and, if the chunk has changed
+    // (and state.throttles.mesh allows), snapshots it and starts a new one:
+    // on state.jobs if async, otherwise meshed and uploaded immediately
+    // can_start = false only uploads
+    // returns the build's job if one was submitted
+    // main thread only, once per frame
+    util::Jobs::Handle update(bool async, bool can_start = true);
+
+    // takes build's dirty sections which are still current and uploads them,
+    // their vertex storage is handed to bgfx and swapped for other storage
+    void upload(Build &build);
+
+    // meshes build's dirty sections into build.sections, reads nothing but
+    // the build (and tile definitions) so it can run on any thread
+    // uses the calling thread's scratch arena (util::Jobs::scratch), and
+    // does not allocate once build's storage has grown to fit, which upload
+    // keeps (see gfx::RefPool::ref)
+    static void mesh(Build &build);
+
+    inline usize num_vertices() const {
+        usize n = 0;
+        for (const auto &mesh : this->sections) {
+            n += mesh.num_vertices();
+        }
+        return n;
+    }
+
+    inline usize num_quads() const {
+        usize n = 0;
+        for (const auto &mesh : this->sections) {
+            n += mesh.num_quads();
+        }
+        return n;
+    }
+
+    // true once a build has been uploaded
+    inline bool meshed() const {
+        return this->mesh_version != std::numeric_limits<usize>::max();
+    }
+
+    // bounds (area space) of the chunk's current mesh, nullopt if it is empty
+    std::optional<util::AABB> aabb() const;
+
+    // bounds (area space) of section s
+    inline util::AABB section_aabb(usize s) const {
+        const f32 scale = this->chunk->scale();
+        const auto min =
+            glm::vec3(
+                this->chunk->offset_tiles
+                    + glm::ivec3(0, s * Chunk::SECTION_SIZE.y, 0))
+                * scale;
+        return util::AABB(
+            min, min + (glm::vec3(Chunk::SECTION_SIZE) * scale));
+    }
+
+    // size of the sections' ranges in the geometry pool
+    inline usize gpu_bytes() const {
+        usize n = 0;
+        for (const auto &mesh : this->sections) {
+            n += mesh.range.count;
+        }
+        return n * sizeof(ChunkVertex);
+    }
+
+    // bit s of sections is set if section s should be drawn
+    static_assert(Chunk::SECTIONS <= 8);
+    static constexpr u8 ALL_SECTIONS = (1 << Chunk::SECTIONS) - 1;
+
+    // mask of sections which have anything to draw
+    inline u8 nonempty() const {
+        u8 mask = 0;
+        for (usize s = 0; s < Chunk::SECTIONS; s++) {
+            if (this->sections[s].num_quads() > 0) {
+                mask |= 1 << s;
+            }
+        }
+        return mask;
+    }
 
-    void mesh();
     void render(
         Tile::RenderPass render_pass,
-        bgfx::ViewId view = 0, u64 render_state = 0);
+        bgfx::ViewId view = 0, u64 render_state = 0,
+        u8 sections = ALL_SECTIONS);
 };
 
 }
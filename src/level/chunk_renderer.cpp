@@ -49,9 +49,6 @@ using namespace level;
 // unique vertices which make up each face
 static const usize UNIQUE_INDICES[] = {0, 1, 2, 5};
 
-// indices into emitted vertices which make up the two faces for a cube face
-static const usize FACE_INDICES[] = {0, 1, 2, 0, 2, 3};
-
 static const usize CUBE_INDICES[] = {
     4, 7, 6, 4, 6, 5, // (south (+z))
     3, 0, 1, 3, 1, 2, // (north (-z))
@@ -61,36 +58,30 @@ static const usize CUBE_INDICES[] = {
     0, 3, 7, 0, 7, 4  // (down  (-y))
 };
 
-static const glm::vec3 CUBE_VERTICES[] = {
-    glm::vec3(0, 0, 0),
-    glm::vec3(0, 1, 0),
-    glm::vec3(1, 1, 0),
-    glm::vec3(1, 0, 0),
-    glm::vec3(0, 0, 1),
-    glm::vec3(0, 1, 1),
-    glm::vec3(1, 1, 1),
-    glm::vec3(1, 0, 1)
-};
-
-static const glm::vec3 CUBE_NORMALS[] = {
-    glm::vec3( 0,  0,  1),
-    glm::vec3( 0,  0, -1),
-    glm::vec3( 1,  0,  0),
-    glm::vec3(-1,  0,  0),
-    glm::vec3( 0,  1,  0),
-    glm::vec3( 0, -1,  0),
+static const glm::ivec3 CUBE_VERTICES[] = {
+    glm::ivec3(0, 0, 0),
+    glm::ivec3(0, 1, 0),
+    glm::ivec3(1, 1, 0),
+    glm::ivec3(1, 0, 0),
+    glm::ivec3(0, 0, 1),
+    glm::ivec3(0, 1, 1),
+    glm::ivec3(1, 1, 1),
+    glm::ivec3(1, 0, 1)
 };
 
-static const glm::vec2 CUBE_UVS[] = {
-    glm::vec2(0, 0),
-    glm::vec2(1, 0),
-    glm::vec2(1, 1),
-    glm::vec2(0, 1),
+static const glm::ivec2 CUBE_UVS[] = {
+    glm::ivec2(0, 0),
+    glm::ivec2(1, 0),
+    glm::ivec2(1, 1),
+    glm::ivec2(0, 1),
 };
 
 // static data for ChunkVertex
 bgfx::VertexLayout ChunkRenderer::ChunkVertex::layout;
 
+// static data for ChunkRenderer
+gfx::RefPool<ChunkRenderer::ChunkVertex> ChunkRenderer::vertex_refs;
+
 void ChunkRenderer::ChunkVertex::create_layout() {
     static bool initialized;
 
@@ -98,202 +89,544 @@ void ChunkRenderer::ChunkVertex::create_layout() {
         return;
     }
 
+    // unpacked in vs_chunk/vs_water (see unpack_chunk_vertex in common.sc)
     layout
         .begin()
-        .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
-        .add(bgfx::Attrib::Normal, 3, bgfx::AttribType::Float, true)
-        .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float)
-        .add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Float)
+        .add(bgfx::Attrib::Position, 4, bgfx::AttribType::Uint8, false, true)
+        .add(bgfx::Attrib::TexCoord0, 4, bgfx::AttribType::Uint8, false, true)
         .end();
 
     initialized = true;
 }
 
-ChunkRenderer::ChunkRenderer(Chunk &chunk)
-    : chunk(chunk) {
-    // TODO: pick a decent default size
+ChunkRenderer::ChunkRenderer(Chunk &chunk, gfx::GeometryPool &geometry) {
+    // layout of the geometry pool's pages
     ChunkVertex::create_layout();
-    this->vertex_buffer =
-        util::RDUniqueResource<bgfx::DynamicVertexBufferHandle>(
-            bgfx::createDynamicVertexBuffer(
-                16,
-                ChunkVertex::layout,
-                BGFX_BUFFER_ALLOW_RESIZE),
-            [](auto handle) { bgfx::destroy(handle); });
-    this->index_buffer =
-        util::RDUniqueResource<bgfx::DynamicIndexBufferHandle>(
-            bgfx::createDynamicIndexBuffer(
-                16,
-                BGFX_BUFFER_ALLOW_RESIZE
-                | BGFX_BUFFER_INDEX32),
-            [](auto handle) { bgfx::destroy(handle); });
+
+    this->geometry = &geometry;
+    this->recycle(chunk, geometry);
+}
+
+ChunkRenderer::~ChunkRenderer() {
+    this->release();
+}
+
+void ChunkRenderer::release() {
+    for (auto &section : this->sections) {
+        this->geometry->free(section.range);
+        section.quads = {};
+    }
+
+    this->mesh_version = std::numeric_limits<usize>::max();
+}
+
+void ChunkRenderer::recycle(Chunk &chunk, gfx::GeometryPool &geometry) {
+    this->release();
+    this->chunk = &chunk;
+    this->geometry = &geometry;
+    this->mesh_version = std::numeric_limits<usize>::max();
+    this->invalidated = false;
+
+    // a build still running belongs to the previous chunk, leave it to its
+    // job and start over with new storage
+    if (this->building) {
+        this->build = nullptr;
+        this->build_job = nullptr;
+        this->building = false;
+    }
+
+    for (auto &section : this->sections) {
+        section.version = std::numeric_limits<u64>::max();
+        section.quads = {};
+        section.visibility = { SectionVisibility::ALL };
+        section.occluders.runs = {};
+    }
+}
+
+void ChunkRenderer::set_mesher(Mesher mesher) {
+    if (mesher != this->mesher) {
+        this->mesher = mesher;
+        this->invalidated = true;
+    }
+}
+
+// cube vertex i (of UNIQUE_INDICES) of face in direction
+static inline const glm::ivec3 &face_vertex(
+    util::Direction direction, usize i) {
+    return CUBE_VERTICES[CUBE_INDICES[(direction * 6) + UNIQUE_INDICES[i]]];
 }
 
-static void emit_face(
-    std::vector<ChunkRenderer::ChunkVertex> &vertices,
-    std::vector<u32> &indices,
-    glm::vec3 position,
-    glm::vec2 uv_offset,
-    glm::vec2 uv_size,
-    glm::vec4 material,
+// emits the 4 vertices of a face of a cube at position (chunk space) with size
+// (in tiles) at vertices and advances it, the texture at atlas cell texture
+// repeats once per tile
+static inline void emit_face(
+    ChunkRenderer::ChunkVertex *&vertices,
+    glm::ivec3 position,
+    glm::ivec3 size,
+    glm::ivec2 texture,
+    const Tile &tile,
     util::Direction direction) {
-    // index offset
-    const usize offset = vertices.size();
+    // size of face along uv axes: u runs from vertex 0 to 1, v from 1 to 2
+    const auto uv_extent =
+        glm::ivec2(
+            glm::dot(
+                glm::abs(face_vertex(direction, 1) - face_vertex(direction, 0)),
+                size),
+            glm::dot(
+                glm::abs(face_vertex(direction, 2) - face_vertex(direction, 1)),
+                size));
 
     // emit vertices
     for (usize i = 0; i < 4; i++) {
-        ChunkRenderer::ChunkVertex vertex;
-        vertex.pos =
-            position +
-            CUBE_VERTICES[
-                CUBE_INDICES[(direction * 6) + UNIQUE_INDICES[i]]];
-        vertex.normal = CUBE_NORMALS[direction];
-        vertex.uv = (CUBE_UVS[i] * uv_size) + uv_offset;
-        vertex.material = material;
-        vertices.push_back(vertex);
+        const auto pos = position + (face_vertex(direction, i) * size);
+        const auto uv = CUBE_UVS[i] * uv_extent;
+        *vertices++ =
+            ChunkRenderer::ChunkVertex(
+                pos, direction, uv, texture, tile.material.shininess);
     }
+}
+
+// vertices of a section being meshed, one region per pass in scratch memory
+// with room for SectionMesh::MAX_FACES faces so that emitting never has to
+// check for space or grow anything
+struct SectionQuads {
+    std::array<ChunkRenderer::ChunkVertex*, Tile::RenderPass::COUNT>
+        begin, end;
 
-    // emit indices
-    for (usize i : FACE_INDICES) {
-        indices.push_back(offset + i);
+    inline usize quads(usize pass) const {
+        return (this->end[pass] - this->begin[pass]) / 4;
     }
+};
+
+// true if the face of t touching t_n is not visible
+static inline bool hides(const Tile &t, const Tile &t_n) {
+    return t_n.id != ID_AIR
+        && (t_n.transparency == Tile::Transparency::OFF
+            || (t_n.transparency == Tile::Transparency::MERGED
+                && t_n.id == t.id));
 }
 
-static inline void emit_tile(
-    ChunkRenderer &renderer,
-    std::vector<ChunkRenderer::ChunkVertex> &vertices,
-    std::vector<u32> &indices,
-    glm::ivec3 pos) {
+// true if uniform section s of tile t is completely enclosed by tiles which
+// hide all of its faces
+static bool section_hidden(
+    const ChunkSnapshot &snap, usize s, const Tile &t) {
+    const auto size = Chunk::SECTION_SIZE;
+    const auto base = glm::ivec3(0, s * size.y, 0);
+
+    for (const util::Direction d : util::Direction::ALL) {
+        const auto dv = static_cast<glm::ivec3>(d);
+
+        // layer of tiles just outside of the section in direction d, out of
+        // area/world is air in the snapshot
+        auto min = base, max = base + size - 1;
+        for (int a = 0; a < 3; a++) {
+            if (dv[a] > 0) {
+                min[a] = max[a] = base[a] + size[a];
+            } else if (dv[a] < 0) {
+                min[a] = max[a] = base[a] - 1;
+            }
+        }
 
-    auto &chunk = renderer.chunk;
-    const auto pos_w = pos + chunk.offset_tiles;
-    const auto &t = state.tiles[chunk.tiles[pos]];
-    const auto uv_unit = glm::vec2(1.0f) / glm::vec2(16.0f);
+        glm::ivec3 p;
+        for (p.x = min.x; p.x <= max.x; p.x++) {
+            for (p.y = min.y; p.y <= max.y; p.y++) {
+                for (p.z = min.z; p.z <= max.z; p.z++) {
+                    if (!hides(t, state.tiles[snap[p]])) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
 
-    // pack material into vec4
-    const auto &material = t.material;
-    const glm::vec4 material_pack =
-        glm::vec4(
-            glm::vec3(0.0),
-            static_cast<f32>(material.shininess) / 255.0f);
+static inline void emit_tile(
+    const ChunkSnapshot &snap,
+    ChunkRenderer::ChunkVertex *&vertices,
+    glm::ivec3 pos) {
+    const auto pos_w = pos + snap.offset_tiles;
+    const auto &t = state.tiles[snap[pos]];
 
     for (auto d = util::Direction(0);
         d < util::Direction::COUNT;
         d++) {
 
         const auto n = pos + static_cast<glm::ivec3>(d);
-        const auto &t_n = state.tiles[Chunk::TileData::from(chunk.or_area(n))];
-
-        if (t_n.id == ID_AIR
-            || (t_n.transparency != Tile::Transparency::OFF
-                && (t_n.transparency != Tile::Transparency::MERGED
-                    || t_n.id != t.id))) {
-            const auto uv_offset = t.texture_offset(chunk.area, pos_w, d);
+        const auto &t_n = state.tiles[snap[n]];
 
+        if (!hides(t, t_n)) {
             emit_face(
-                vertices, indices,
-                glm::vec3(pos),
-                glm::vec2(uv_offset.x, 16 - uv_offset.y - 1) * uv_unit,
-                uv_unit,
-                material_pack,
+                vertices,
+                pos,
+                glm::ivec3(1),
+                t.texture_offset(*snap.area, pos_w, d),
+                t,
                 d);
         }
     }
 }
 
-void ChunkRenderer::mesh() {
-    // TODO: convert these to arena allocated (or preallocated) vectors
-    struct Pass {
-        std::vector<ChunkVertex> vertices;
-        std::vector<u32> indices;
+// key of a visible face for greedy meshing, faces with equal keys (same
+// tile, so same material and render pass, and same texture) can be merged
+// 0 is no face
+static inline u64 face_key(TileId tile, const glm::ivec2 &texture) {
+    return (1ull << 63)
+        | (static_cast<u64>(tile) << 32)
+        | (static_cast<u64>(texture.x & 0xFFFF) << 16)
+        | static_cast<u64>(texture.y & 0xFFFF);
+}
 
-        Pass() : vertices(), indices() {};
-    } passes[Tile::RenderPass::COUNT];
+// greedy meshing: for each direction, each slice of the section along it is
+// turned into a mask of face keys which is then covered with as few
+// rectangles as possible, each emitted as one quad with a tiled texture
+static void mesh_section_greedy(
+    const ChunkSnapshot &snap,
+    SectionQuads &out,
+    usize s,
+    bool shell) {
+    const auto size = Chunk::SECTION_SIZE;
+    const auto base = glm::ivec3(0, s * size.y, 0);
+
+    static_assert(
+        Chunk::SECTION_SIZE.x == Chunk::SECTION_SIZE.y
+            && Chunk::SECTION_SIZE.y == Chunk::SECTION_SIZE.z);
+    constexpr int N = Chunk::SECTION_SIZE.x;
+    std::array<u64, N * N> mask;
+
+    for (auto d = util::Direction(0);
+        d < util::Direction::COUNT;
+        d++) {
+        const auto dv = static_cast<glm::ivec3>(d);
+
+        // normal axis n, mask axes a and b
+        const int
+            n = dv.x != 0 ? 0 : (dv.y != 0 ? 1 : 2),
+            a = n == 0 ? 1 : 0,
+            b = n == 2 ? 1 : 2;
+
+        // only the outward facing slice of a shell can have visible faces
+        int k_min = 0, k_max = N - 1;
+        if (shell) {
+            k_min = k_max = dv[n] > 0 ? N - 1 : 0;
+        }
+
+        for (int k = k_min; k <= k_max; k++) {
+            for (int i = 0; i < N; i++) {
+                for (int j = 0; j < N; j++) {
+                    glm::ivec3 pos;
+                    pos[n] = k;
+                    pos[a] = i;
+                    pos[b] = j;
+                    pos += base;
+
+                    auto &key = mask[i * N + j];
+                    key = 0;
+
+                    const TileId id = snap[pos];
+                    if (id == 0) {
+                        continue;
+                    }
+
+                    const auto &t = state.tiles[id];
+                    const auto &t_n = state.tiles[snap[pos + dv]];
+
+                    if (!hides(t, t_n)) {
+                        key =
+                            face_key(
+                                id,
+                                t.texture_offset(
+                                    *snap.area, pos + snap.offset_tiles, d));
+                    }
+                }
+            }
+
+            for (int i = 0; i < N; i++) {
+                for (int j = 0; j < N;) {
+                    const u64 key = mask[i * N + j];
+                    if (key == 0) {
+                        j++;
+                        continue;
+                    }
+
+                    // grow along b, then along a while entire rows match
+                    int w = 1, h = 1;
+                    while (j + w < N && mask[i * N + j + w] == key) {
+                        w++;
+                    }
+
+                    while (i + h < N) {
+                        const auto row = &mask[(i + h) * N + j];
+                        if (!std::all_of(
+                                row, row + w,
+                                [&](u64 k) { return k == key; })) {
+                            break;
+                        }
+                        h++;
+                    }
+
+                    for (int ii = i; ii < i + h; ii++) {
+                        std::fill(
+                            &mask[ii * N + j], &mask[ii * N + j + w], 0);
+                    }
+
+                    glm::ivec3 pos, extent;
+                    pos[n] = k;
+                    pos[a] = i;
+                    pos[b] = j;
+                    extent[n] = 1;
+                    extent[a] = h;
+                    extent[b] = w;
+
+                    const auto &t = state.tiles[(key >> 32) & 0xFFFF];
+                    const auto texture =
+                        glm::ivec2(
+                            static_cast<i16>((key >> 16) & 0xFFFF),
+                            static_cast<i16>(key & 0xFFFF));
+                    const auto pass = t.render_pass;
+
+                    emit_face(
+                        out.end[pass],
+                        base + pos,
+                        extent,
+                        texture,
+                        t,
+                        d);
+
+                    j += w;
+                }
+            }
+        }
+    }
+}
+
+// meshes section s of snap into out, reads nothing but snap (and tile
+// definitions)
+static void mesh_section(
+    const ChunkSnapshot &snap,
+    SectionQuads &out,
+    ChunkRenderer::Mesher mesher,
+    usize s) {
+    // uniform sections: skip if air or fully enclosed, otherwise only their
+    // outer shell can have visible faces (unless tiles are transparent to
+    // themselves)
+    bool shell = false;
+    if (const auto u = snap.uniform[s]) {
+        const auto &t = state.tiles[*u];
+
+        if (t.id == ID_AIR || section_hidden(snap, s, t)) {
+            return;
+        }
 
-    glm::ivec3 pos;
-    for (pos.x = 0; pos.x < Chunk::SIZE.x; pos.x++) {
-        for (pos.y = 0; pos.y < Chunk::SIZE.y; pos.y++) {
-            for (pos.z = 0; pos.z < Chunk::SIZE.z; pos.z++) {
-                const TileId t = this->chunk[pos];
+        shell = t.transparency != Tile::Transparency::ON;
+    }
+
+    if (mesher == ChunkRenderer::GREEDY) {
+        mesh_section_greedy(snap, out, s, shell);
+        return;
+    }
+
+    const auto size = Chunk::SECTION_SIZE;
+    const auto base = glm::ivec3(0, s * size.y, 0);
+
+    glm::ivec3 p;
+    for (p.x = 0; p.x < size.x; p.x++) {
+        for (p.y = 0; p.y < size.y; p.y++) {
+            const bool inner =
+                shell
+                && p.x > 0 && p.x < size.x - 1
+                && p.y > 0 && p.y < size.y - 1;
+
+            for (p.z = 0;
+                 p.z < size.z;
+                 p.z += (inner && p.z == 0) ? (size.z - 1) : 1) {
+                const auto pos = base + p;
+                const TileId t = snap[pos];
                 if (t == 0) {
                     continue;
                 }
 
                 const auto pass = state.tiles[t].render_pass;
-                emit_tile(
-                    *this, passes[pass].vertices, passes[pass].indices, pos);
+                emit_tile(snap, out.end[pass], pos);
             }
         }
     }
+}
 
-    usize num_vertices = 0, num_indices = 0;
+void ChunkRenderer::mesh(Build &build) {
+    // scratch is per thread, and also reset after every job
+    auto &scratch = util::Jobs::scratch();
+    auto *mark = scratch.cur;
 
-    // TODO: pre-size according to size of other vectors
-    std::vector<ChunkVertex> merged_vertices;
-    std::vector<u32> merged_indices;
+    constexpr usize max_vertices = SectionMesh::MAX_FACES * 4;
+    static_assert(
+        Tile::RenderPass::COUNT * max_vertices * sizeof(ChunkVertex)
+            <= util::Jobs::SCRATCH_SIZE);
 
+    SectionQuads quads;
     for (usize i = 0; i < Tile::RenderPass::COUNT; i++) {
-        auto &vertices = passes[i].vertices;
-        auto &indices = passes[i].indices;
-
-        if (vertices.size() == 0 || indices.size() == 0) {
-            this->pass_indices[i] = {
-                .num_indices = 0,
-                .indices_start = 0,
-                .num_vertices = 0,
-                .vertices_start = 0
-            };
+        quads.begin[i] =
+            reinterpret_cast<ChunkVertex*>(
+                scratch.alloc(max_vertices * sizeof(ChunkVertex)));
+    }
+
+    for (usize s = 0; s < Chunk::SECTIONS; s++) {
+        if (!build.dirty[s]) {
             continue;
         }
 
-        this->pass_indices[i] = {
-            .num_indices = indices.size(),
-            .indices_start = num_indices,
-            .num_vertices = vertices.size(),
-            .vertices_start = num_vertices
-        };
+        quads.end = quads.begin;
+        mesh_section(build.snapshot, quads, build.mesher, s);
 
-        merged_vertices.insert(
-            merged_vertices.end(), vertices.begin(), vertices.end());
+        // lay passes out one after another in the section's storage, only
+        // grows (and allocates) past the largest mesh it has held
+        auto &mesh = build.sections[s];
+        mesh.visibility = SectionVisibility::compute(build.snapshot, s);
+        mesh.occluders = SectionOccluders::compute(build.snapshot, s);
+        mesh.vertices.clear();
 
-        merged_indices.insert(
-            merged_indices.end(), indices.begin(), indices.end());
+        for (usize i = 0; i < Tile::RenderPass::COUNT; i++) {
+            mesh.quads[i] = quads.quads(i);
+            mesh.vertices.insert(
+                mesh.vertices.end(), quads.begin[i], quads.end[i]);
+        }
+    }
 
-        num_vertices += vertices.size();
-        num_indices += indices.size();
+    scratch.cur = mark;
+}
+
+util::Jobs::Handle ChunkRenderer::update(bool async, bool can_start) {
+    if (this->building && util::Jobs::done(this->build_job)) {
+        this->building = false;
+        this->build_job = nullptr;
+        this->upload(*this->build);
     }
 
-    // must either be empty or have something
-    util::_assert((num_indices == 0) == (num_vertices == 0));
-
-    if (num_vertices > 0 && num_indices > 0) {
-        bgfx::update(
-            this->vertex_buffer,0,
-            bgfx::copy(
-                &merged_vertices[0],
-                merged_vertices.size() * sizeof(merged_vertices[0])));
-
-        bgfx::update(
-            this->index_buffer, 0,
-            bgfx::copy(
-                &merged_indices[0],
-                merged_indices.size() * sizeof(merged_indices[0])));
+    if (this->building
+            || !can_start
+            || (!this->invalidated
+                && this->chunk->version == this->mesh_version)
+            || state.throttles.mesh >= state.throttles.mesh_max) {
+        return nullptr;
     }
+
+    state.throttles.mesh++;
+
+    if (!this->build) {
+        this->build = std::make_shared<Build>();
+    }
+
+    auto &build = *this->build;
+    this->chunk->snapshot(build.snapshot);
+    build.mesher = this->mesher;
+
+    for (usize s = 0; s < Chunk::SECTIONS; s++) {
+        build.dirty[s] =
+            this->invalidated
+            || this->sections[s].version != build.snapshot.versions[s];
+    }
+
+    this->invalidated = false;
+
+    if (!async) {
+        ChunkRenderer::mesh(build);
+        this->upload(build);
+        return nullptr;
+    }
+
+    this->building = true;
+    this->build_job =
+        state.jobs.submit(
+            [build = this->build]() { ChunkRenderer::mesh(*build); });
+    return this->build_job;
 }
 
-void ChunkRenderer::render(
-    Tile::RenderPass render_pass,
-    bgfx::ViewId view, u64 render_state) {
-    // re-mesh if dirty
-    if (this->chunk.version != this->mesh_version &&
-        state.throttles.mesh < state.throttles.mesh_max) {
-        this->mesh();
-        this->mesh_version = this->chunk.version;
-        state.throttles.mesh++;
+static_assert(
+    ChunkRenderer::MAX_SECTION_RANGE
+        == ChunkRenderer::with_slack(
+            ChunkRenderer::SectionMesh::MAX_FACES * 4));
+
+void ChunkRenderer::upload(Build &build) {
+    // take re-meshed sections which are still current, those which changed
+    // since the snapshot keep their previous mesh until the next build
+    // each is uploaded to its own range in the geometry pool, straight from
+    // the build's storage (see vertex_refs) which the build then swaps for
+    // storage bgfx is done with
+    for (usize s = 0; s < Chunk::SECTIONS; s++) {
+        auto &mesh = this->sections[s];
+        const u64 version = build.snapshot.versions[s];
+        if (!build.dirty[s] || version != this->chunk->versions[s]) {
+            continue;
+        }
+
+        mesh.quads = build.sections[s].quads;
+        mesh.visibility = build.sections[s].visibility;
+        mesh.occluders = build.sections[s].occluders;
+        mesh.version = version;
+
+        // every pass is drawn from the shared quad indices
+        for (const usize n : mesh.quads) {
+            state.renderer.quad_indices->reserve(n);
+        }
+
+        // move to a new range if the mesh outgrew its own or shrank to well
+        // under it, only this section is touched either way
+        const usize num_vertices = mesh.num_vertices();
+        if (num_vertices > mesh.range.count
+                || with_slack(num_vertices) < mesh.range.count / 2) {
+            this->geometry->free(mesh.range);
+
+            if (num_vertices > 0) {
+                mesh.range = this->geometry->alloc(with_slack(num_vertices));
+            }
+        }
+
+        if (num_vertices == 0) {
+            continue;
+        }
+
+        // slack is left as it was
+        this->geometry->update(
+            mesh.range, 0,
+            vertex_refs.ref(build.sections[s].vertices));
     }
 
-    // empty mesh! gfx APIs will freak out if you submit with nothing
-    if (this->mesh_version != this->chunk.version) {
+    this->mesh_version = build.snapshot.version;
+}
+
+std::optional<util::AABB> ChunkRenderer::aabb() const {
+    // lowest and highest sections with anything in them
+    std::optional<usize> s_min, s_max;
+    for (usize s = 0; s < Chunk::SECTIONS; s++) {
+        if (this->sections[s].num_quads() > 0) {
+            s_min = s_min.value_or(s);
+            s_max = s;
+        }
+    }
+
+    if (!s_min) {
+        return std::nullopt;
+    }
+
+    const auto
+        min = glm::vec3(0, *s_min * Chunk::SECTION_SIZE.y, 0),
+        max =
+            glm::vec3(
+                Chunk::SIZE.x,
+                (*s_max + 1) * Chunk::SECTION_SIZE.y,
+                Chunk::SIZE.z);
+    const f32 scale = this->chunk->scale();
+    const auto offset = glm::vec3(this->chunk->offset_tiles);
+    return util::AABB((min + offset) * scale, (max + offset) * scale);
+}
+
+void ChunkRenderer::render(
+    Tile::RenderPass render_pass,
+    bgfx::ViewId view, u64 render_state,
+    u8 sections) {
+    // never meshed, nothing to draw
+    if (!this->meshed()) {
         return;
     }
 
@@ -306,38 +639,50 @@ void ChunkRenderer::render(
 
     render_state |= 0; // triangle list
 
+    gfx::Program *program = nullptr;
+    switch (render_pass) {
+        case Tile::DEFAULT:
+            program = state.renderer.programs["chunk"].get();
+            break;
+        case Tile::WATER:
+            program = state.renderer.programs["water"].get();
+            break;
+        default:
+            util::_assert(false);
+    }
+
+    // downsampled chunks are meshed in their own tiles and scaled up
+    const f32 scale = this->chunk->scale();
     auto model =
-        glm::translate(
-            glm::mat4(1.0),
-            glm::vec3(this->chunk.offset * Chunk::SIZE));
-    bgfx::setTransform(reinterpret_cast<void *>(&model));
-
-    if (this->pass_indices[render_pass].num_indices != 0) {
-        bgfx::setVertexBuffer(
-            0, this->vertex_buffer,
-            this->pass_indices[render_pass].vertices_start,
-            this->pass_indices[render_pass].num_vertices);
-        bgfx::setIndexBuffer(
-            this->index_buffer,
-            this->pass_indices[render_pass].indices_start,
-            this->pass_indices[render_pass].num_indices);
+        glm::scale(
+            glm::translate(
+                glm::mat4(1.0),
+                glm::vec3(this->chunk->offset_tiles) * scale),
+            glm::vec3(scale));
+
+    // one draw per section, possibly stale if section is waiting on a
+    // throttled or in progress re-mesh
+    for (usize s = 0; s < Chunk::SECTIONS; s++) {
+        const auto &mesh = this->sections[s];
+        const usize num_quads = mesh.quads[render_pass];
+        if (num_quads == 0 || !(sections & (1 << s))) {
+            continue;
+        }
+
+        // skip over previous passes
+        const usize before = mesh.quads_before(render_pass);
+
+        bgfx::setTransform(reinterpret_cast<void *>(&model));
+        this->geometry->set(0, mesh.range, before * 4, num_quads * 4);
+        state.renderer.quad_indices->set(num_quads);
         bgfx::setState(render_state);
 
-        gfx::Program *program = nullptr;
-        switch (render_pass) {
-            case Tile::DEFAULT:
-                program = state.renderer.programs["chunk"].get();
-                break;
-            case Tile::WATER:
-                program = state.renderer.programs["water"].get();
-                program->try_set(
-                    "time",
-                    glm::vec4(state.time.ticks));
-                program->try_set(
-                    "s_noise", 1, *state.renderer.textures["noise"]);
-                break;
-            default:
-                util::_assert(false);
+        if (render_pass == Tile::WATER) {
+            program->try_set(
+                "time",
+                glm::vec4(state.time.ticks));
+            program->try_set(
+                "s_noise", 1, *state.renderer.textures["noise"]);
         }
 
         program->try_set("s_tex", 0, *state.renderer.textures["blocks"]);
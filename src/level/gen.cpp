@@ -1,5 +1,6 @@
 #include "level/gen.hpp"
 #include "level/area.hpp"
+#include "state.hpp"
 
 using namespace level;
 
@@ -11,35 +12,29 @@ enum Biome {
 
 constexpr int WATER_LEVEL = 64;
 
+constexpr u64 SEED = 4;
+
+// max. distance (in columns) from its trunk which a tree can reach
+constexpr int TREE_RADIUS = 2;
+
+struct Column {
+    int h, d;
+    Biome biome;
+    TileId top;
+};
+
 static inline void set(
     Chunk &chunk, const glm::ivec3 &pos, TileId tile,
     bool only_empty = false) {
-    const auto
-        pos_w = chunk.offset_tiles + pos,
-        offset = Area::to_offset(pos_w);
-
-    if (Chunk::in_bounds(pos) && (!only_empty || chunk.tiles[pos] == 0)) {
+    // anything outside of the chunk is written by that chunk's own gen()
+    if (Chunk::in_bounds(pos)
+        && (!only_empty || chunk.tiles[pos] == 0)) {
         chunk.tiles[pos] = tile;
-    } else if (
-        chunk.area.contains_chunk(offset)
-        && (!only_empty || chunk.area.tiles[pos_w] == 0)) {
-        chunk.area.tiles[pos_w] = tile;
-    } else {
-        chunk.area.out_of_bounds_tiles.push_back(
-            std::make_tuple(pos_w, tile));
     }
 }
 
-static inline TileId get(Chunk &chunk, const glm::ivec3 &pos) {
-    return chunk.tiles.safe(pos);
-}
-
+// tree with its trunk at pos (chunk space, may be outside of the chunk)
 void tree(Chunk &chunk, util::Rand &rand, const glm::ivec3 &pos) {
-    const auto under = get(chunk, pos - glm::ivec3(0, 1, 0));
-    if (under != ID_GRASS && under != ID_DIRT) {
-        return;
-    }
-
     int h = rand.next<int>(4, 6);
 
     for (int y = pos.y; y <= pos.y + h; y++) {
@@ -69,120 +64,445 @@ void tree(Chunk &chunk, util::Rand &rand, const glm::ivec3 &pos) {
     layer(1, h - 1 + lh, th, 0.8);
 }
 
-void level::gen(Chunk &chunk) {
-    const u64 seed = 4;
-    auto rand = util::rand(1);
+// noise fields sampled for every column, see GenCache::fill
+struct Fields {
+    // biome (at xz) and extra (at -xz) noise
+    util::Octave n;
 
-    // biome noise
-    auto n = util::Octave(seed, 6, 0);
+    // height noise, at xz * BASE_SCALE
+    util::Octave o_0, o_1;
+    util::Combined c;
 
-    auto os = util::make_array(
-        util::Octave(seed, 8, 1),
-        util::Octave(seed, 8, 2),
-        util::Octave(seed, 8, 3),
-        util::Octave(seed, 8, 4),
-        util::Octave(seed, 8, 5),
-        util::Octave(seed, 8, 6));
+    static constexpr f32 BASE_SCALE = 1.3f;
 
-    auto cs = util::make_array(
-        util::Combined(os[0], os[1]),
-        util::Combined(os[2], os[3]),
-        util::Combined(os[4], os[5]));
+    explicit Fields(u64 seed)
+        : n(seed, 6, 0),
+          o_0(seed, 8, 1),
+          o_1(seed, 8, 2),
+          c(o_0, o_1) {}
+    Fields(const Fields &other) = delete;
+};
 
-    for (int x = 0; x < Chunk::SIZE.x; x++) {
-        for (int z = 0; z < Chunk::SIZE.z; z++) {
-            const auto xz_w = glm::ivec2(x, z) + chunk.offset_tiles.xz();
-
-            const f32 base_scale = 1.3f;
-            int
-                hr,
-                hl = (cs[0].sample(glm::vec2(xz_w) * base_scale) / 6.0f) - 4.0f,
-                hh = (cs[0].sample(glm::vec2(xz_w) * base_scale) / 6.0f) + 6.0f;
-
-            // sample biome noise, extra noise
-            f32 t = n.sample(xz_w),
-                r = n.sample(-xz_w);
-            hr = t > 0 ? hl : glm::max(hh, hl);
-
-            // offset by water level to determine biome
-            int h = hr + WATER_LEVEL;
-
-            Biome biome;
-            if (h < WATER_LEVEL) {
-                biome = OCEAN;
-            } else if (t < 0.08f && h < WATER_LEVEL + 2) {
-                biome = BEACH;
+// column from its height noise, biome noise (t) and extra noise (r)
+static Column make_column(f32 height, f32 t, f32 r) {
+    int
+        hr,
+        hl = (height / 6.0f) - 4.0f,
+        hh = (height / 6.0f) + 6.0f;
+
+    hr = t > 0 ? hl : glm::max(hh, hl);
+
+    // offset by water level to determine biome
+    int h = hr + WATER_LEVEL;
+
+    Biome biome;
+    if (h < WATER_LEVEL) {
+        biome = OCEAN;
+    } else if (t < 0.08f && h < WATER_LEVEL + 2) {
+        biome = BEACH;
+    } else {
+        biome = PLAINS;
+    }
+
+    // dirt/sand depth
+    int d = r * 1.4f + 5.0f;
+
+    TileId top;
+    switch (biome) {
+        case OCEAN:
+            if (r > 0.1f || t > 0.01f) {
+                top = ID_SAND;
             } else {
-                biome = PLAINS;
+                top = ID_DIRT;
             }
+            break;
+        case BEACH:
+            top = ID_SAND;
+            break;
+        default:
+            top = ID_GRASS;
+            break;
+    }
 
-            // dirt/sand depth
-            int d = r * 1.4f + 5.0f;
+    return { .h = h, .d = d, .biome = biome, .top = top };
+}
 
-            TileId top;
-            switch (biome) {
-                case OCEAN:
-                    if (r > 0.1f || t > 0.01f) {
-                        top = ID_SAND;
-                    } else {
-                        top = ID_DIRT;
-                    }
-                    break;
-                case BEACH:
-                    top = ID_SAND;
-                    break;
-                default:
-                    top = ID_GRASS;
-                    break;
-            }
+// column at xz_w from its region's noise
+static Column make_column(
+    const GenCache::Region &region, const glm::ivec2 &xz_w) {
+    const usize i = region.index(xz_w);
+    return make_column(region.height[i], region.biome[i], region.extra[i]);
+}
 
-            // build column
-            for (int y = 0; y < h; y++) {
-                TileId tile;
-
-                if (y == (h - 1)) {
-                    tile = top;
-                } else if (y > (h - d)) {
-                    if (top == ID_GRASS) {
-                        tile = ID_DIRT;
-                    } else {
-                        tile = top;
-                    }
-                } else {
-                    tile = ID_STONE;
+static u64 now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GenCache::GenCache(usize capacity, int biome_step)
+    : capacity(std::max<usize>(capacity, 1)),
+      biome_step(biome_step) {
+    util::_assert(
+        biome_step > 0 && REGION_SIZE % biome_step == 0,
+        "biome_step must divide REGION_SIZE");
+}
+
+std::shared_ptr<const GenCache::Region> GenCache::get(
+    u64 seed, const glm::ivec2 &xz, usize chunk_columns) {
+    const auto key = Key { .region = GenCache::to_region(xz), .seed = seed };
+
+    std::shared_ptr<Entry> entry;
+    bool hit;
+
+    {
+        std::lock_guard lock(this->mutex);
+        auto &e = this->entries[key];
+        hit = e != nullptr;
+
+        if (!hit) {
+            e = std::make_shared<Entry>();
+        }
+
+        entry = e;
+        entry->used = this->clock++;
+
+        // drop least recently used regions, never the one just added as it
+        // is the most recently used
+        while (this->entries.size() > this->capacity) {
+            auto lru = this->entries.begin();
+            for (auto it = this->entries.begin();
+                 it != this->entries.end();
+                 it++) {
+                if (it->second->used < lru->second->used) {
+                    lru = it;
                 }
+            }
+            this->entries.erase(lru);
+        }
+    }
+
+    // sample outside of the lock, anyone else asking for this region waits
+    // here until it is done
+    std::call_once(entry->filled, [&]() {
+        auto region = std::make_shared<Region>();
+        region->origin = key.region * REGION_SIZE;
+        this->fill(*region, seed);
+        entry->region = std::move(region);
+    });
+
+    const auto &region = entry->region;
+    const i64
+        fill_ns = region->fill_ns,
+        share = (fill_ns * chunk_columns) / REGION_COLUMNS;
+
+    if (hit) {
+        this->hits++;
+        this->saved_ns += share;
+    } else {
+        this->misses++;
+        this->saved_ns -= fill_ns - share;
+    }
+
+    return region;
+}
+
+void GenCache::clear() {
+    std::lock_guard lock(this->mutex);
+    this->entries.clear();
+}
+
+void GenCache::fill(Region &region, u64 seed) const {
+    const auto start = now_ns();
 
-                chunk.tiles[glm::ivec3(x, y, z)] = tile;
+    const Fields fields(seed);
+    const auto &n = fields.n;
+    std::vector<glm::vec2> points(REGION_COLUMNS);
+
+    const auto each = [&](int size, int step, auto f) {
+        for (int x = 0; x < size; x++) {
+            for (int z = 0; z < size; z++) {
+                f(x * size + z, region.origin + (glm::ivec2(x, z) * step));
             }
+        }
+    };
+
+    each(REGION_SIZE, 1, [&](usize i, const glm::ivec2 &xz_w) {
+        points[i] = glm::vec2(xz_w) * Fields::BASE_SCALE;
+    });
+    fields.c.sample_batch(points, region.height);
+
+    if (this->biome_step == 1) {
+        each(REGION_SIZE, 1, [&](usize i, const glm::ivec2 &xz_w) {
+            points[i] = xz_w;
+        });
+        n.sample_batch(points, region.biome);
+
+        each(REGION_SIZE, 1, [&](usize i, const glm::ivec2 &xz_w) {
+            points[i] = -xz_w;
+        });
+        n.sample_batch(points, region.extra);
+    } else {
+        // sample a lattice of (m x m) points which includes the far edges of
+        // the region, then interpolate every column from it
+        const int step = this->biome_step, m = (REGION_SIZE / step) + 1;
+        const auto lattice = std::span(points).subspan(0, m * m);
+        std::vector<f32> biome(m * m), extra(m * m);
+
+        each(m, step, [&](usize i, const glm::ivec2 &xz_w) {
+            lattice[i] = xz_w;
+        });
+        n.sample_batch(lattice, biome);
+
+        each(m, step, [&](usize i, const glm::ivec2 &xz_w) {
+            lattice[i] = -xz_w;
+        });
+        n.sample_batch(lattice, extra);
 
-            for (int y = h; y < WATER_LEVEL; y++) {
-                chunk.tiles[glm::ivec3(x, y, z)] = ID_WATER;
+        const auto interpolate =
+            [&](const std::vector<f32> &ys, int x, int z) {
+                const int l_x = x / step, l_z = z / step;
+                const f32
+                    t_x = (x % step) / static_cast<f32>(step),
+                    t_z = (z % step) / static_cast<f32>(step);
+                return glm::mix(
+                    glm::mix(
+                        ys[l_x * m + l_z], ys[l_x * m + l_z + 1], t_z),
+                    glm::mix(
+                        ys[(l_x + 1) * m + l_z],
+                        ys[(l_x + 1) * m + l_z + 1], t_z),
+                    t_x);
+            };
+
+        for (int x = 0; x < REGION_SIZE; x++) {
+            for (int z = 0; z < REGION_SIZE; z++) {
+                const usize i = x * REGION_SIZE + z;
+                region.biome[i] = interpolate(biome, x, z);
+                region.extra[i] = interpolate(extra, x, z);
             }
+        }
+    }
+
+    region.fill_ns = now_ns() - start;
+}
+
+GenCache &level::gen_cache() {
+    auto &settings = state.platform.settings;
+    static GenCache cache(
+        std::max<i64>(settings["gen"]["cache_regions"].value_or(64), 1),
+        std::max<i64>(settings["gen"]["biome_step"].value_or(1), 1));
+    return cache;
+}
+
+void level::gen(Chunk &chunk) {
+    const u64 seed = SEED;
+
+    static_assert(Chunk::SIZE.x == Chunk::SIZE.z);
+
+    // columns of this chunk plus a border of TREE_RADIUS: trees with their
+    // trunks in neighboring chunks are generated here as well (and the
+    // parts of this chunk's trees outside of it are generated by the
+    // neighbors) so that a chunk only depends on seed and its offset
+    constexpr int
+        SIZE = Chunk::SIZE.x + (2 * TREE_RADIUS),
+        REGION_SIZE = GenCache::REGION_SIZE;
+    std::array<Column, SIZE * SIZE> columns;
+
+    const auto
+        p_min = chunk.offset_tiles.xz() - TREE_RADIUS,
+        p_max = p_min + (SIZE - 1),
+        r_min = GenCache::to_region(p_min),
+        r_max = GenCache::to_region(p_max);
+
+    util::_assert(
+        glm::all(glm::lessThanEqual(r_max - r_min, glm::ivec2(1))),
+        "padded chunk spans more than 2x2 regions");
+
+    // 2D noise for the columns, shared with the rest of their regions
+    auto &cache = gen_cache();
+    std::array<std::shared_ptr<const GenCache::Region>, 4> regions;
 
-            if (biome == PLAINS && rand.next<f32>(0, 1) < 0.001) {
-                tree(chunk, rand, glm::ivec3(x, h, z));
+    for (int x = r_min.x; x <= r_max.x; x++) {
+        for (int z = r_min.y; z <= r_max.y; z++) {
+            const auto r = glm::ivec2(x, z);
+            const auto
+                lo = glm::max(p_min, r * REGION_SIZE),
+                hi = glm::min(p_max, ((r + 1) * REGION_SIZE) - 1);
+            const auto n = hi - lo + 1;
+
+            regions[(x - r_min.x) * 2 + (z - r_min.y)] =
+                cache.get(seed, r * REGION_SIZE, n.x * n.y);
+        }
+    }
+
+    // height of stone which is present in every column of the chunk
+    int stone_top = Chunk::SIZE.y;
+
+    for (int x = 0; x < SIZE; x++) {
+        for (int z = 0; z < SIZE; z++) {
+            const auto xz_w = p_min + glm::ivec2(x, z);
+            const auto r = GenCache::to_region(xz_w) - r_min;
+            const auto c = make_column(*regions[r.x * 2 + r.y], xz_w);
+            columns[x * SIZE + z] = c;
+
+            const auto xz = xz_w - chunk.offset_tiles.xz();
+            if (Chunk::in_bounds(glm::ivec3(xz.x, 0, xz.y))) {
+                // everything in [0, min(h - d + 1, h - 1)) is stone
+                stone_top =
+                    glm::min(stone_top, glm::min(c.h - c.d + 1, c.h - 1));
             }
         }
     }
 
-    // add out-of-bounds tiles in this chunk
-    for (auto it = chunk.area.out_of_bounds_tiles.begin();
-         it != chunk.area.out_of_bounds_tiles.end();) {
-        auto [pos, tile] = *it;
-        const auto pos_c = pos - chunk.offset_tiles;
-
-        if (Chunk::in_bounds(pos_c)) {
-            chunk.tiles[pos_c] = tile;
-            it = chunk.area.out_of_bounds_tiles.erase(it);
-        } else {
-            it++;
+    // fill sections which are entirely stone in one go
+    const usize filled =
+        glm::max(stone_top, 0) / Chunk::SECTION_SIZE.y;
+    for (usize s = 0; s < filled; s++) {
+        chunk.fill_section(s, ID_STONE);
+    }
+
+    const int y_start = filled * Chunk::SECTION_SIZE.y;
+
+    for (int x = 0; x < Chunk::SIZE.x; x++) {
+        for (int z = 0; z < Chunk::SIZE.z; z++) {
+            const auto &[h, d, biome, top] =
+                columns[(x + TREE_RADIUS) * SIZE + (z + TREE_RADIUS)];
+
+            // build column: stone, then dirt/sand, then top, then water
+            const auto column = [&](int y_min, int y_max, TileId tile) {
+                chunk.fill(
+                    util::AABBi(
+                        glm::ivec3(x, glm::max(y_min, y_start), z),
+                        glm::ivec3(x, y_max, z)),
+                    tile);
+            };
+
+            column(0, glm::min(h - d, h - 2), ID_STONE);
+            column(h - d + 1, h - 2, top == ID_GRASS ? ID_DIRT : top);
+            column(h - 1, h - 1, top);
+            column(h, WATER_LEVEL - 1, ID_WATER);
+        }
+    }
+
+    // trees after all terrain, in world (x, z) order over every column which
+    // can reach this chunk: any tile sees the same trees in the same order
+    // no matter which chunk generates it
+    // randomness is hashed from seed and position instead of drawn from a
+    // shared stream, so it does not depend on what was generated before
+    for (int x = 0; x < SIZE; x++) {
+        for (int z = 0; z < SIZE; z++) {
+            const auto &[h, d, biome, top] = columns[x * SIZE + z];
+            const auto xz_w = p_min + glm::ivec2(x, z);
+
+            if (biome != PLAINS
+                || (top != ID_GRASS && top != ID_DIRT)
+                || util::hash_to_unit(util::hash_with_seed(seed, xz_w))
+                    >= 0.001) {
+                continue;
+            }
+
+            const auto xz = xz_w - chunk.offset_tiles.xz();
+            auto rand = util::rand_from_hash(seed + 1, xz_w);
+            tree(chunk, rand, glm::ivec3(xz.x, h, xz.y));
         }
     }
+}
+
+void level::gen_lod(Chunk &chunk) {
+    const int scale = chunk.scale();
+    util::_assert(scale > 1, "gen_lod on a chunk which is not downsampled");
+
+    static_assert(Chunk::SIZE.x == Chunk::SIZE.z);
+    constexpr int N = Chunk::SIZE.x;
+
+    // each cell column samples the corners of the (scale x scale) columns it
+    // covers and keeps the highest, so that downsampled terrain tends to be
+    // above the real terrain and the skirts of its borders (see
+    // Chunk::snapshot) cover cracks against finer levels
+    constexpr usize SAMPLES = 4, COUNT = N * N * SAMPLES;
+
+    const Fields fields(SEED);
+    std::array<glm::vec2, COUNT> points;
+    std::array<f32, COUNT> height, biome, extra;
+
+    const auto each = [&](auto f) {
+        for (usize i = 0; i < COUNT; i++) {
+            const int cell = i / SAMPLES, corner = i % SAMPLES;
+            const auto xz_w =
+                ((chunk.offset_tiles.xz() + glm::ivec2(cell / N, cell % N))
+                    * scale)
+                + (glm::ivec2(corner / 2, corner % 2) * (scale - 1));
+            f(i, xz_w);
+        }
+    };
+
+    each([&](usize i, const glm::ivec2 &xz_w) {
+        points[i] = glm::vec2(xz_w) * Fields::BASE_SCALE;
+    });
+    fields.c.sample_batch(points, height);
+
+    each([&](usize i, const glm::ivec2 &xz_w) {
+        points[i] = xz_w;
+    });
+    fields.n.sample_batch(points, biome);
+
+    each([&](usize i, const glm::ivec2 &xz_w) {
+        points[i] = -xz_w;
+    });
+    fields.n.sample_batch(points, extra);
 
-    // bump versions of neighboring chunks
-    for (auto *c : chunk.neighbors()) {
-        if (c) {
-            c->version++;
+    // cells above the world's height in this chunk stay empty
+    const int cells = Chunk::SIZE.y / scale;
+
+    for (int x = 0; x < N; x++) {
+        for (int z = 0; z < N; z++) {
+            const usize base = (x * N + z) * SAMPLES;
+
+            auto c = make_column(height[base], biome[base], extra[base]);
+            for (usize i = base + 1; i < base + SAMPLES; i++) {
+                const auto other = make_column(height[i], biome[i], extra[i]);
+                if (other.h > c.h) {
+                    c = other;
+                }
+            }
+
+            // each cell is the tile at its top as gen() would place it,
+            // without trees: the surface tile if the cell contains it,
+            // water between the surface and water level
+            const auto tile = [&](int y) -> TileId {
+                const int lo = y * scale, hi = lo + scale - 1;
+
+                if (lo > c.h - 1) {
+                    return lo < WATER_LEVEL ? ID_WATER : 0;
+                } else if (hi >= c.h - 1) {
+                    return c.top;
+                } else if (hi <= glm::min(c.h - c.d, c.h - 2)) {
+                    return ID_STONE;
+                }
+
+                return c.top == ID_GRASS ? ID_DIRT : c.top;
+            };
+
+            // fill runs of the same tile
+            int start = 0;
+            TileId run = tile(0);
+
+            for (int y = 1; y <= cells; y++) {
+                const TileId next = y < cells ? tile(y) : 0;
+                if (y < cells && next == run) {
+                    continue;
+                }
+
+                if (run != 0) {
+                    chunk.fill(
+                        util::AABBi(
+                            glm::ivec3(x, start, z),
+                            glm::ivec3(x, y - 1, z)),
+                        run);
+                }
+
+                start = y;
+                run = next;
+            }
         }
     }
 }
@@ -7,7 +7,112 @@ namespace level {
 // forward declaration
 struct Chunk;
 
+// 2D noise fields used by gen(), sampled once per region of
+// (REGION_SIZE x REGION_SIZE) columns and shared by every chunk in it
+// safe to use from multiple generator threads at once
+struct GenCache {
+    static constexpr int REGION_SIZE = 64;
+    static constexpr usize REGION_COLUMNS = REGION_SIZE * REGION_SIZE;
+
+    struct Region {
+        // area-space column of index 0
+        glm::ivec2 origin;
+
+        // per column: height noise, biome noise, extra (dirt depth) noise
+        std::array<f32, REGION_COLUMNS> height, biome, extra;
+
+        // time taken to sample this region
+        u64 fill_ns = 0;
+
+        // index of area-space column xz, which must be in this region
+        inline usize index(const glm::ivec2 &xz) const {
+            const auto l = xz - this->origin;
+            return l.x * REGION_SIZE + l.y;
+        }
+    };
+
+    // max. number of regions kept, least recently used are dropped first
+    usize capacity;
+
+    // biome and extra noise are sampled every biome_step columns and
+    // interpolated in between, 1 samples every column
+    int biome_step;
+
+    // get() calls which found their region already sampled/had to sample it
+    std::atomic<usize> hits = 0, misses = 0;
+
+    // estimated time saved by hits, minus time spent sampling the parts of
+    // regions which were not (yet) asked for
+    std::atomic<i64> saved_ns = 0;
+
+    explicit GenCache(usize capacity = 64, int biome_step = 1);
+
+    // region containing area-space column xz for seed, sampled on first use
+    // chunk_columns is the number of columns the caller uses, for saved_ns
+    std::shared_ptr<const Region> get(
+        u64 seed, const glm::ivec2 &xz, usize chunk_columns);
+
+    void clear();
+
+    inline f64 hit_rate() const {
+        const usize n = this->hits + this->misses;
+        return n == 0 ? 0.0 : this->hits / static_cast<f64>(n);
+    }
+
+    // average time saved per get()
+    inline f64 saved_ns_per_chunk() const {
+        const usize n = this->hits + this->misses;
+        return n == 0 ? 0.0 : this->saved_ns / static_cast<f64>(n);
+    }
+
+    static inline glm::ivec2 to_region(const glm::ivec2 &xz) {
+        return glm::ivec2(
+            util::floor_div(xz.x, REGION_SIZE),
+            util::floor_div(xz.y, REGION_SIZE));
+    }
+
+private:
+    struct Key {
+        glm::ivec2 region;
+        u64 seed;
+
+        inline bool operator==(const Key &other) const {
+            return this->region == other.region && this->seed == other.seed;
+        }
+    };
+
+    struct KeyHash {
+        inline usize operator()(const Key &k) const {
+            const usize h = std::hash<glm::ivec2>{}(k.region);
+            return h ^ (k.seed + 0x9E3779B97F4A7C15 + (h << 6) + (h >> 2));
+        }
+    };
+
+    struct Entry {
+        std::once_flag filled;
+        std::shared_ptr<Region> region;
+
+        // value of clock when last used
+        u64 used;
+    };
+
+    // protects entries, clock
+    std::mutex mutex;
+    std::unordered_map<Key, std::shared_ptr<Entry>, KeyHash> entries;
+    u64 clock = 0;
+
+    void fill(Region &region, u64 seed) const;
+};
+
+// cache used by gen(), configured by [gen] in settings on first use
+GenCache &gen_cache();
+
 void gen(Chunk &chunk);
+
+// generates a downsampled chunk (Chunk::lod > 0) straight from the noise,
+// one cell per (scale x scale x scale) tiles of what gen() would generate,
+// without trees
+void gen_lod(Chunk &chunk);
 }
 
 #endif
@@ -81,6 +81,10 @@ int main(UNUSED int argc, UNUSED char *argv[]) {
             util::read_file(state.platform.resources_path + "/defaults.toml")
                 .unwrap());
 
+    state.jobs.start(
+        std::max<i64>(
+            state.platform.settings["jobs"]["threads"].value_or(0), 0));
+
     state.platform.window =
         std::unique_ptr<platform::GLFW::Window>(
             new platform::GLFW::Window(
@@ -106,16 +110,22 @@ int main(UNUSED int argc, UNUSED char *argv[]) {
     state.platform.get_input<platform::Mouse>()
         .set_mode(platform::Mouse::DISABLED);
 
-    area = std::make_unique<level::Area>(level::gen);
+    area = std::make_unique<level::Area>(level::gen, level::gen_lod);
     area_renderer = std::make_unique<level::AreaRenderer>(*area);
 
+    // far plane reaches the outermost downsampled chunks
+    const f32 view_distance =
+        std::max<f32>(
+            area->lod_radius(area->lod_levels) * level::Chunk::SIZE.x,
+            128.0f);
+
     auto window_size = state.platform.window->get_size();
     state.player =
         Player(
             util::PerspectiveCamera(
                 glm::radians(75.0f),
                 window_size.x / (f32) window_size.y,
-                glm::vec2(0.08f, 128.0f)),
+                glm::vec2(0.08f, view_distance)),
             area.get());
 
     float time = 0.0;
@@ -148,10 +158,29 @@ int main(UNUSED int argc, UNUSED char *argv[]) {
             state.player.flying = !state.player.flying;
         }
 
+        if (keyboard["f3"] && (*keyboard["f3"])->pressed) {
+            area->debug_stats();
+            area_renderer->debug_stats();
+            state.jobs.debug_stats();
+        }
+
+        if (keyboard["g"] && (*keyboard["g"])->pressed) {
+            area_renderer->mesher =
+                area_renderer->mesher == level::ChunkRenderer::GREEDY ?
+                    level::ChunkRenderer::PER_FACE
+                    : level::ChunkRenderer::GREEDY;
+            util::log::out()
+                << "mesher: "
+                << (area_renderer->mesher == level::ChunkRenderer::GREEDY ?
+                    "greedy" : "per face")
+                << util::log::end;
+        }
+
         auto &composite = *state.renderer.programs["composite"];
         composite.try_set("u_show_buffer", glm::vec4(0, 0, 0, 0));
 
         update();
+        area_renderer->update();
 
         state.time.section_render.begin();
         render();
@@ -162,11 +191,11 @@ int main(UNUSED int argc, UNUSED char *argv[]) {
         state.renderer.sun.update(*area, state.player.camera);
         // TODO: !!!
         state.renderer.composite(
-            [&](bgfx::ViewId view, u64 flags) {
+            [&](bgfx::ViewId view, u64 flags, const util::Camera &camera) {
                 area_renderer->render(
-                    level::Tile::RenderPass::DEFAULT, view, flags);
+                    level::Tile::RenderPass::DEFAULT, camera, view, flags);
                 area_renderer->render(
-                    level::Tile::RenderPass::WATER, view, flags);
+                    level::Tile::RenderPass::WATER, camera, view, flags);
             });
 
         state.throttles.gen = 0;
@@ -12,6 +12,7 @@ struct State {
     util::Time time;
     util::Bump frame_allocator;
     level::Tiles tiles;
+    util::Jobs jobs;
 
     // TODO: remove this when proper entities are added
     Player player;
@@ -57,6 +57,8 @@ struct Tile {
     virtual util::AABB aabb(
         Area &area, const glm::vec3 pos) const;
 
+    // called from meshing jobs, must not read area (which may be changing
+    // on the main thread)
     virtual glm::ivec2 texture_offset(
         Area &area, const glm::ivec3 pos, util::Direction dir) const;
 };
@@ -33,19 +33,25 @@ struct Bump {
         }
     }
 
+    // messages are only built on failure, so that allocating from the
+    // arena never touches the heap
     inline void *alloc(usize n) {
-        util::_assert(this->mem, "Bump allocator not initialized");
+        if (!this->mem) {
+            util::_assert(false, "Bump allocator not initialized");
+        }
 
         usize align =
             reinterpret_cast<usize>(this->cur) % 16 != 0 ?
                 16 - (reinterpret_cast<usize>(this->cur) % 16)
                 : 0;
 
-        util::_assert(
-            this->cur + align + n <= this->end,
-            "Bump allocator at "
-                + std::to_string(reinterpret_cast<usize>(this))
-                + " out of memory!");
+        if (this->cur + align + n > this->end) {
+            util::_assert(
+                false,
+                "Bump allocator at "
+                    + std::to_string(reinterpret_cast<usize>(this))
+                    + " out of memory!");
+        }
 
         void *res = this->cur + align;
         this->cur += align + n;
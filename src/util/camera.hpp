@@ -4,6 +4,7 @@
 #include "gfx/bgfx.hpp"
 #include "util/types.hpp"
 #include "util/math.hpp"
+#include "util/frustum.hpp"
 
 // forward declaration
 namespace gfx {
@@ -20,6 +21,11 @@ struct Camera {
         bgfx::setViewTransform(_view, &view, &proj);
     }
 
+    // frustum of the current view and projection
+    inline Frustum frustum() const {
+        return Frustum(this->proj * this->view);
+    }
+
     virtual void set_uniforms(const std::string &prefix, gfx::Program &p);
 
     virtual void update(const glm::mat4 &view = glm::mat4(0));
@@ -0,0 +1,73 @@
+#ifndef UTIL_FRUSTUM_HPP
+#define UTIL_FRUSTUM_HPP
+
+#include "util/types.hpp"
+#include "util/std.hpp"
+#include "util/math.hpp"
+#include "util/aabb.hpp"
+
+namespace util {
+// view frustum as 6 planes (ax + by + cz + d >= 0 is inside) extracted from a
+// view-projection matrix, works for perspective and orthographic projections
+struct Frustum {
+    enum Result {
+        OUTSIDE = 0,
+        INTERSECTS = 1,
+        INSIDE = 2
+    };
+
+    // left, right, bottom, top, near, far
+    std::array<glm::vec4, 6> planes;
+
+    Frustum() = default;
+
+    explicit Frustum(const glm::mat4 &view_proj) {
+        const auto row =
+            [&](usize i) {
+                return glm::vec4(
+                    view_proj[0][i], view_proj[1][i],
+                    view_proj[2][i], view_proj[3][i]);
+            };
+
+        // near is -w <= z, which is also (conservatively) correct for
+        // projections with a [0, 1] depth range
+        this->planes = {
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(3) + row(2),
+            row(3) - row(2)
+        };
+    }
+
+    // classifies aabb against the frustum, tests only the box corners
+    // furthest along/against each plane's normal so it may report boxes
+    // near the frustum's corners as intersecting
+    inline Result test(const AABB &aabb) const {
+        Result result = INSIDE;
+
+        for (const auto &plane : this->planes) {
+            const auto n = glm::vec3(plane);
+            const auto positive = glm::greaterThan(n, glm::vec3(0.0f));
+            const auto
+                p = glm::mix(aabb.min, aabb.max, positive),
+                q = glm::mix(aabb.max, aabb.min, positive);
+
+            if (glm::dot(n, p) + plane.w < 0.0f) {
+                return OUTSIDE;
+            } else if (glm::dot(n, q) + plane.w < 0.0f) {
+                result = INTERSECTS;
+            }
+        }
+
+        return result;
+    }
+
+    inline bool contains(const AABB &aabb) const {
+        return this->test(aabb) != OUTSIDE;
+    }
+};
+}
+
+#endif
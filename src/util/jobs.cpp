@@ -0,0 +1,260 @@
+#include "util/jobs.hpp"
+#include "util/log.hpp"
+
+using namespace util;
+
+// worker running on this thread: the instance it belongs to (nullptr if not
+// a worker) and its index there
+static thread_local const Jobs *worker_jobs = nullptr;
+static thread_local ssize worker_index = -1;
+
+// index of this thread's worker in jobs, -1 if it is not one of its workers
+static inline ssize worker_of(const Jobs *jobs) {
+    return worker_jobs == jobs ? worker_index : -1;
+}
+
+Jobs::~Jobs() {
+    this->stop();
+}
+
+void Jobs::start(usize n) {
+    util::_assert(this->workers.empty(), "Jobs already started");
+
+    if (n == 0) {
+        n = std::max<usize>(std::thread::hardware_concurrency(), 2) - 1;
+    }
+
+    // keep any queue made by enqueue() before starting
+    this->stopping = false;
+    while (this->queues.size() < n) {
+        this->queues.emplace_back(std::make_unique<Worker>());
+    }
+
+    for (usize i = 0; i < n; i++) {
+        auto *worker = this->queues[i].get();
+        this->workers.push_back(worker);
+        worker->thread = std::thread([this, i]() { this->work(i); });
+    }
+}
+
+void Jobs::stop() {
+    {
+        std::lock_guard lock(this->sleep_mutex);
+        this->stopping = true;
+    }
+
+    this->sleep_cv.notify_all();
+
+    for (auto *worker : this->workers) {
+        worker->thread.join();
+    }
+
+    this->workers.clear();
+    this->queues.clear();
+    this->queued = 0;
+}
+
+Jobs::Handle Jobs::submit(Fn fn, std::span<const Handle> deps) {
+    auto job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+    job->remaining = 1;
+    job->done = false;
+    this->submitted++;
+
+    for (const auto &dep : deps) {
+        if (!dep) {
+            continue;
+        }
+
+        std::lock_guard lock(dep->mutex);
+        if (!dep->done) {
+            dep->dependents.push_back(job);
+            job->remaining++;
+        }
+    }
+
+    if (--job->remaining == 0) {
+        this->enqueue(job);
+    }
+
+    return job;
+}
+
+Jobs::Handle Jobs::parallel_for(
+    usize begin, usize end, usize grain,
+    std::function<void(usize)> fn,
+    std::span<const Handle> deps) {
+    grain = std::max<usize>(grain, 1);
+
+    auto shared = std::make_shared<std::function<void(usize)>>(std::move(fn));
+
+    std::vector<Handle> parts;
+    for (usize b = begin; b < end; b += grain) {
+        const usize e = std::min(b + grain, end);
+        parts.push_back(
+            this->submit(
+                [shared, b, e]() {
+                    for (usize i = b; i < e; i++) {
+                        (*shared)(i);
+                    }
+                },
+                deps));
+    }
+
+    return this->submit([]() {}, parts);
+}
+
+void Jobs::wait(const Handle &job) {
+    while (!Jobs::done(job)) {
+        if (auto other = this->find(worker_of(this))) {
+            this->run(other);
+            continue;
+        }
+
+        std::unique_lock lock(this->sleep_mutex);
+        this->sleep_cv.wait(lock, [&]() {
+            return Jobs::done(job) || this->queued > 0 || this->stopping;
+        });
+
+        if (this->stopping && this->workers.empty()) {
+            break;
+        }
+    }
+}
+
+util::Bump &Jobs::scratch() {
+    static thread_local util::Bump bump(SCRATCH_SIZE);
+    return bump;
+}
+
+void Jobs::enqueue(Handle job) {
+    // no queues before start(), make one so jobs can at least be waited on
+    if (this->queues.empty()) {
+        this->queues.emplace_back(std::make_unique<Worker>());
+    }
+
+    const ssize index = worker_of(this);
+    auto &worker =
+        index >= 0 ?
+            *this->queues[index]
+            : *this->queues[this->next_queue++ % this->queues.size()];
+
+    // count first so that queued never underflows when popped
+    this->queued++;
+
+    {
+        std::lock_guard lock(worker.mutex);
+        worker.queue.push_back(std::move(job));
+    }
+
+    // lock so that a worker can't miss the wakeup between checking queued
+    // and going to sleep
+    { std::lock_guard lock(this->sleep_mutex); }
+    this->sleep_cv.notify_one();
+}
+
+void Jobs::run(Handle job) {
+    // restore scratch arena afterwards, jobs can run inside of other jobs
+    // through wait()
+    auto &bump = Jobs::scratch();
+    auto *mark = bump.cur;
+    job->fn();
+    bump.cur = mark;
+
+    // release anything captured by the job now rather than when the last
+    // handle to it goes away
+    job->fn = nullptr;
+    this->executed++;
+
+    std::vector<Handle> dependents;
+    {
+        std::lock_guard lock(job->mutex);
+        job->done = true;
+        dependents.swap(job->dependents);
+    }
+
+    for (auto &dependent : dependents) {
+        if (--dependent->remaining == 0) {
+            this->enqueue(std::move(dependent));
+        }
+    }
+
+    // wake anyone waiting on this job
+    { std::lock_guard lock(this->sleep_mutex); }
+    this->sleep_cv.notify_all();
+}
+
+Jobs::Handle Jobs::find(ssize self) {
+    if (this->queued == 0) {
+        return nullptr;
+    }
+
+    // own queue, newest first
+    if (self >= 0) {
+        auto &worker = *this->queues[self];
+        std::lock_guard lock(worker.mutex);
+
+        if (!worker.queue.empty()) {
+            auto job = std::move(worker.queue.back());
+            worker.queue.pop_back();
+            this->queued--;
+            return job;
+        }
+    }
+
+    // steal, oldest first
+    const usize n = this->queues.size();
+    for (usize i = 0; i < n; i++) {
+        const usize q = (std::max<ssize>(self, 0) + i) % n;
+        if (static_cast<ssize>(q) == self) {
+            continue;
+        }
+
+        auto &worker = *this->queues[q];
+        std::lock_guard lock(worker.mutex);
+
+        if (!worker.queue.empty()) {
+            auto job = std::move(worker.queue.front());
+            worker.queue.pop_front();
+            this->queued--;
+
+            if (self >= 0) {
+                this->stolen++;
+            }
+
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void Jobs::work(usize index) {
+    worker_jobs = this;
+    worker_index = index;
+
+    while (true) {
+        if (auto job = this->find(index)) {
+            this->run(job);
+            continue;
+        }
+
+        std::unique_lock lock(this->sleep_mutex);
+        this->sleep_cv.wait(lock, [this]() {
+            return this->stopping || this->queued > 0;
+        });
+
+        if (this->stopping) {
+            return;
+        }
+    }
+}
+
+void Jobs::debug_stats() const {
+    util::log::out()
+        << "jobs: " << this->size() << " workers, "
+        << this->submitted << " submitted, "
+        << this->executed << " executed, "
+        << this->stolen << " stolen"
+        << util::log::end;
+}
@@ -0,0 +1,119 @@
+#ifndef UTIL_JOBS_HPP
+#define UTIL_JOBS_HPP
+
+#include "util/std.hpp"
+#include "util/types.hpp"
+#include "util/assert.hpp"
+#include "util/arena.hpp"
+
+namespace util {
+// work-stealing job scheduler, shared by everything which wants to run work
+// off of the main thread (generation, meshing, etc.)
+// every worker has its own queue: jobs submitted from a worker go on its own
+// queue and are run newest first, idle workers steal the oldest jobs from
+// other workers' queues
+// jobs may depend on other jobs, they are only queued once every dependency
+// is done
+struct Jobs {
+    using Fn = std::function<void()>;
+
+    struct Job {
+        Fn fn;
+
+        // dependencies which are not yet done (+ 1 while being submitted)
+        std::atomic<usize> remaining;
+        std::atomic<bool> done;
+
+        // protects dependents
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Job>> dependents;
+    };
+
+    // handle to a submitted job, can be waited on or depended on
+    // a null handle counts as a job which is already done
+    using Handle = std::shared_ptr<Job>;
+
+    // size of each thread's scratch arena
+    static constexpr usize SCRATCH_SIZE = 4 * 1024 * 1024;
+
+    // jobs submitted/run/run after being stolen from another worker
+    std::atomic<usize> submitted = 0, executed = 0, stolen = 0;
+
+    Jobs() = default;
+    Jobs(const Jobs &other) = delete;
+    Jobs(Jobs &&other) = delete;
+    Jobs &operator=(const Jobs &other) = delete;
+    Jobs &operator=(Jobs &&other) = delete;
+    ~Jobs();
+
+    // starts n worker threads, 0 starts one per hardware thread (minus one
+    // for the main thread)
+    void start(usize n = 0);
+
+    // joins all workers, jobs which have not been run are dropped
+    void stop();
+
+    // number of workers
+    inline usize size() const {
+        return this->workers.size();
+    }
+
+    Handle submit(Fn fn, std::span<const Handle> deps = {});
+
+    inline Handle submit(Fn fn, std::initializer_list<Handle> deps) {
+        return this->submit(
+            std::move(fn), std::span<const Handle>(deps.begin(), deps.size()));
+    }
+
+    // runs fn(i) for every i in [begin, end), split into jobs of at most
+    // grain indices each
+    // returns a job which is done when every index is done
+    Handle parallel_for(
+        usize begin, usize end, usize grain,
+        std::function<void(usize)> fn,
+        std::span<const Handle> deps = {});
+
+    // blocks until job is done, runs other jobs on the calling thread in the
+    // meantime
+    void wait(const Handle &job);
+
+    static inline bool done(const Handle &job) {
+        return !job || job->done;
+    }
+
+    // scratch arena for the calling thread, everything allocated from it in
+    // a job is freed when that job returns
+    static util::Bump &scratch();
+
+    // logs worker and job counts
+    void debug_stats() const;
+
+private:
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<Handle> queue;
+    };
+
+    // one queue per worker, always at least one so that jobs can be
+    // submitted (and then run by wait()) without any workers
+    std::vector<std::unique_ptr<Worker>> queues;
+    std::vector<Worker*> workers;
+
+    // number of jobs in all queues, workers sleep on this
+    std::atomic<usize> queued = 0;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    bool stopping = false;
+
+    // queue for jobs submitted from non-worker threads
+    std::atomic<usize> next_queue = 0;
+
+    void enqueue(Handle job);
+    void run(Handle job);
+    Handle find(ssize self);
+    void work(usize index);
+};
+}
+
+#endif
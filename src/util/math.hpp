@@ -61,6 +61,13 @@ inline bool nonzero(const glm::vec<L, T, Q> &v) {
 
 // MISC UTILITIES
 
+// integer division rounding towards -infinity
+template <typename T>
+    requires std::is_integral<T>::value
+inline T floor_div(T a, T b) {
+    return (a / b) - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
 // find the smallest possible t such that s + t * ds is an integer
 inline glm::vec3 intbound(glm::vec3 s, glm::vec3 ds) {
     glm::vec3 res;
@@ -81,15 +88,12 @@ struct Rand {
     std::uniform_real_distribution<f64> d_real;
     std::normal_distribution<f64> d_normal;
 
+    // only touches std::random_device if there is no seed
     Rand(std::optional<usize> seed)
-        : rng(std::random_device()()),
+        : rng(seed ? *seed : std::random_device()()),
           d_int(0, UINT64_MAX),
           d_real(0.0, 1.0),
-          d_normal(0.0, 1.0) {
-        if (seed) {
-            this->seed(*seed);
-        }
-    }
+          d_normal(0.0, 1.0) {}
 
     // NOTE: bounds are inclusive
     template <typename T>
@@ -127,6 +131,31 @@ template <typename T>
 inline auto rand_from_hash(T t) {
     return Rand(std::hash<T>{}(t));
 }
+
+// 64-bit integer hash (splitmix64 finalizer)
+inline u64 mix_hash(u64 x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+    return x ^ (x >> 31);
+}
+
+// counter-based hash of object and seed: a pure function of both, unlike
+// drawing from a shared Rand the result does not depend on call order
+template <typename T>
+inline u64 hash_with_seed(u64 seed, const T &t) {
+    return mix_hash(seed ^ mix_hash(std::hash<T>{}(t)));
+}
+
+// hash to uniform f64 in [0, 1)
+inline f64 hash_to_unit(u64 h) {
+    return (h >> 11) * 0x1.0p-53;
+}
+
+// random number generator with seed based on hash of object and seed
+template <typename T>
+inline auto rand_from_hash(u64 seed, const T &t) {
+    return Rand(hash_with_seed(seed, t));
+}
 }
 
 
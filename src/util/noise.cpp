@@ -1,20 +1,303 @@
 #include "util/noise.hpp"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NOISE_X86
+#endif
+
 using namespace util;
 
 extern "C" {
     #include <noise1234.h>
+
+    // permutation table from noise1234.c
+    extern unsigned char perm[];
+}
+
+// max. number of points handled at once by Combined::sample_batch
+static constexpr usize BATCH_BLOCK = 256;
+
+void Noise::sample_batch(
+    std::span<const glm::vec2> in, std::span<f32> out) const {
+    for (usize i = 0; i < in.size(); i++) {
+        out[i] = this->sample(in[i]);
+    }
 }
 
 f32 Octave::sample(glm::vec2 i) const {
     f32 u = 1.0f, v = 0.0f;
     for (usize j = 0; j < this->n; j++) {
-        v += noise3(i.x / u, i.y / u, this->seed + j + (this->o * 32)) * u;
+        v += noise3(i.x / u, i.y / u, this->z(j)) * u;
         u *= 2.0f;
     }
     return v;
 }
 
+#ifdef NOISE_X86
+// SIMD versions of noise1234's noise3 over lanes of (x, y) with a shared z
+// every operation mirrors the scalar code in the same order (and without
+// FMA) so that results are bit-identical
+
+// perm widened to 32 bits for gathers
+static const i32 *perm32() {
+    static const auto table = []() {
+        std::array<i32, 512> t;
+        for (usize i = 0; i < t.size(); i++) {
+            t[i] = perm[i];
+        }
+        return t;
+    }();
+    return &table[0];
+}
+
+// scalar parts of noise3 which only depend on z
+struct NoiseZ {
+    i32 pz0, pz1;
+    f32 fz0, fz1, r;
+
+    explicit NoiseZ(f32 z) {
+        // FASTFLOOR, which is off by one on exact integers (as in noise1234)
+        i32 iz0 = static_cast<i32>(z) < z ?
+            static_cast<i32>(z) : static_cast<i32>(z) - 1;
+        this->fz0 = z - iz0;
+        this->fz1 = this->fz0 - 1.0f;
+        this->pz0 = perm[iz0 & 0xFF];
+        this->pz1 = perm[(iz0 + 1) & 0xFF];
+        this->r =
+            this->fz0 * this->fz0 * this->fz0
+                * (this->fz0 * (this->fz0 * 6 - 15) + 10);
+    }
+};
+
+// _p: intrinsic prefix (_mm/_mm256), _i: integer vector suffix (si128/si256)
+// _w: function name suffix
+#define NOISE_SIMD_IMPL(_target, _vf, _vi, _p, _i, _w, _gather, _lt)         \
+__attribute__((target(_target)))                                              \
+static inline _vf fade_##_w(_vf t) {                                           \
+    return _p##_mul_ps(                                                        \
+        _p##_mul_ps(_p##_mul_ps(t, t), t),                                     \
+        _p##_add_ps(                                                           \
+            _p##_mul_ps(                                                       \
+                t,                                                             \
+                _p##_sub_ps(                                                   \
+                    _p##_mul_ps(t, _p##_set1_ps(6.0f)),                        \
+                    _p##_set1_ps(15.0f))),                                     \
+            _p##_set1_ps(10.0f)));                                             \
+}                                                                              \
+                                                                               \
+__attribute__((target(_target)))                                              \
+static inline _vf lerp_##_w(_vf t, _vf a, _vf b) {                             \
+    return _p##_add_ps(a, _p##_mul_ps(t, _p##_sub_ps(b, a)));                  \
+}                                                                              \
+                                                                               \
+__attribute__((target(_target)))                                              \
+static inline _vf grad3_##_w(_vi hash, _vf x, _vf y, _vf z) {                  \
+    const _vi h = _p##_and_##_i(hash, _p##_set1_epi32(15));                    \
+    const _vf                                                                  \
+        lt8 = _p##_cast##_i##_ps(_p##_cmpgt_epi32(_p##_set1_epi32(8), h)),     \
+        lt4 = _p##_cast##_i##_ps(_p##_cmpgt_epi32(_p##_set1_epi32(4), h)),     \
+        is_x = _p##_cast##_i##_ps(                                             \
+            _p##_or_##_i(                                                      \
+                _p##_cmpeq_epi32(h, _p##_set1_epi32(12)),                      \
+                _p##_cmpeq_epi32(h, _p##_set1_epi32(14)))),                    \
+        u = _p##_blendv_ps(y, x, lt8),                                         \
+        v = _p##_blendv_ps(_p##_blendv_ps(z, x, is_x), y, lt4),                \
+        su = _p##_cast##_i##_ps(                                               \
+            _p##_slli_epi32(_p##_and_##_i(h, _p##_set1_epi32(1)), 31)),        \
+        sv = _p##_cast##_i##_ps(                                               \
+            _p##_slli_epi32(_p##_and_##_i(h, _p##_set1_epi32(2)), 30));        \
+    return _p##_add_ps(_p##_xor_ps(u, su), _p##_xor_ps(v, sv));                \
+}                                                                              \
+                                                                               \
+/* FASTFLOOR: (int) x < x ? (int) x : (int) x - 1 */                          \
+__attribute__((target(_target)))                                              \
+static inline _vi fastfloor_##_w(_vf x) {                                      \
+    const _vi t = _p##_cvttps_epi32(x);                                        \
+    return _p##_add_epi32(                                                     \
+        t,                                                                     \
+        _p##_andnot_##_i(                                                      \
+            _p##_castps_##_i(_lt(_p##_cvtepi32_ps(t), x)),                     \
+            _p##_set1_epi32(-1)));                                             \
+}                                                                              \
+                                                                               \
+__attribute__((target(_target)))                                              \
+static inline _vf noise3_##_w(_vf x, _vf y, const NoiseZ &nz) {                \
+    const i32 *p = perm32();                                                   \
+    const _vi one = _p##_set1_epi32(1), mask = _p##_set1_epi32(0xFF);          \
+    _vi ix0 = fastfloor_##_w(x), iy0 = fastfloor_##_w(y);                      \
+    const _vf                                                                  \
+        fx0 = _p##_sub_ps(x, _p##_cvtepi32_ps(ix0)),                           \
+        fy0 = _p##_sub_ps(y, _p##_cvtepi32_ps(iy0)),                           \
+        fx1 = _p##_sub_ps(fx0, _p##_set1_ps(1.0f)),                            \
+        fy1 = _p##_sub_ps(fy0, _p##_set1_ps(1.0f)),                            \
+        fz0 = _p##_set1_ps(nz.fz0),                                            \
+        fz1 = _p##_set1_ps(nz.fz1),                                            \
+        r = _p##_set1_ps(nz.r),                                                \
+        t = fade_##_w(fy0),                                                    \
+        s = fade_##_w(fx0);                                                    \
+    const _vi                                                                  \
+        ix1 = _p##_and_##_i(_p##_add_epi32(ix0, one), mask),                   \
+        iy1 = _p##_and_##_i(_p##_add_epi32(iy0, one), mask),                   \
+        pz0 = _p##_set1_epi32(nz.pz0),                                         \
+        pz1 = _p##_set1_epi32(nz.pz1);                                         \
+    ix0 = _p##_and_##_i(ix0, mask);                                            \
+    iy0 = _p##_and_##_i(iy0, mask);                                            \
+    const _vi                                                                  \
+        py00 = _gather(p, _p##_add_epi32(iy0, pz0)),                           \
+        py01 = _gather(p, _p##_add_epi32(iy0, pz1)),                           \
+        py10 = _gather(p, _p##_add_epi32(iy1, pz0)),                           \
+        py11 = _gather(p, _p##_add_epi32(iy1, pz1));                           \
+    _vf nxy0, nxy1, nx0, nx1, n0, n1;                                          \
+    nxy0 = grad3_##_w(_gather(p, _p##_add_epi32(ix0, py00)), fx0, fy0, fz0);   \
+    nxy1 = grad3_##_w(_gather(p, _p##_add_epi32(ix0, py01)), fx0, fy0, fz1);   \
+    nx0 = lerp_##_w(r, nxy0, nxy1);                                            \
+    nxy0 = grad3_##_w(_gather(p, _p##_add_epi32(ix0, py10)), fx0, fy1, fz0);   \
+    nxy1 = grad3_##_w(_gather(p, _p##_add_epi32(ix0, py11)), fx0, fy1, fz1);   \
+    nx1 = lerp_##_w(r, nxy0, nxy1);                                            \
+    n0 = lerp_##_w(t, nx0, nx1);                                               \
+    nxy0 = grad3_##_w(_gather(p, _p##_add_epi32(ix1, py00)), fx1, fy0, fz0);   \
+    nxy1 = grad3_##_w(_gather(p, _p##_add_epi32(ix1, py01)), fx1, fy0, fz1);   \
+    nx0 = lerp_##_w(r, nxy0, nxy1);                                            \
+    nxy0 = grad3_##_w(_gather(p, _p##_add_epi32(ix1, py10)), fx1, fy1, fz0);   \
+    nxy1 = grad3_##_w(_gather(p, _p##_add_epi32(ix1, py11)), fx1, fy1, fz1);   \
+    nx1 = lerp_##_w(r, nxy0, nxy1);                                            \
+    n1 = lerp_##_w(t, nx0, nx1);                                               \
+    return _p##_mul_ps(_p##_set1_ps(0.936f), lerp_##_w(s, n0, n1));            \
+}
+
+// SSE4.1 has no gather, look up lanes one at a time
+__attribute__((target("sse4.1")))
+static inline __m128i gather_sse4(const i32 *p, __m128i i) {
+    return _mm_setr_epi32(
+        p[_mm_extract_epi32(i, 0)], p[_mm_extract_epi32(i, 1)],
+        p[_mm_extract_epi32(i, 2)], p[_mm_extract_epi32(i, 3)]);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128 lt_sse4(__m128 a, __m128 b) {
+    return _mm_cmplt_ps(a, b);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i gather_avx2(const i32 *p, __m256i i) {
+    return _mm256_i32gather_epi32(p, i, 4);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 lt_avx2(__m256 a, __m256 b) {
+    return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+
+NOISE_SIMD_IMPL(
+    "sse4.1", __m128, __m128i, _mm, si128, sse4, gather_sse4, lt_sse4)
+NOISE_SIMD_IMPL(
+    "avx2", __m256, __m256i, _mm256, si256, avx2, gather_avx2, lt_avx2)
+
+// returns number of points done, the rest (count % lanes) are left over
+#define OCTAVE_SIMD_IMPL(_target, _vf, _p, _w, _lanes)                        \
+__attribute__((target(_target)))                                              \
+static usize octave_##_w(                                                      \
+    const Octave &o, const glm::vec2 *in, f32 *out, usize count) {             \
+    usize i = 0;                                                               \
+    for (; i + _lanes <= count; i += _lanes) {                                 \
+        alignas(32) f32 xs[_lanes], ys[_lanes];                                \
+        for (usize k = 0; k < _lanes; k++) {                                   \
+            xs[k] = in[i + k].x;                                               \
+            ys[k] = in[i + k].y;                                               \
+        }                                                                      \
+                                                                               \
+        const _vf x = _p##_load_ps(xs), y = _p##_load_ps(ys);                  \
+        _vf v = _p##_setzero_ps();                                             \
+        f32 u = 1.0f;                                                          \
+        for (usize j = 0; j < o.n; j++) {                                      \
+            const _vf uu = _p##_set1_ps(u);                                    \
+            v = _p##_add_ps(                                                   \
+                v,                                                             \
+                _p##_mul_ps(                                                   \
+                    noise3_##_w(                                               \
+                        _p##_div_ps(x, uu),                                    \
+                        _p##_div_ps(y, uu),                                    \
+                        NoiseZ(o.z(j))),                                       \
+                    uu));                                                      \
+            u *= 2.0f;                                                         \
+        }                                                                      \
+                                                                               \
+        _p##_storeu_ps(&out[i], v);                                            \
+    }                                                                          \
+    return i;                                                                  \
+}
+
+OCTAVE_SIMD_IMPL("sse4.1", __m128, _mm, sse4, 4)
+OCTAVE_SIMD_IMPL("avx2", __m256, _mm256, avx2, 8)
+#endif
+
+Octave::Batch Octave::batch_support() {
+#ifdef NOISE_X86
+    static const Batch support = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return AVX2;
+        } else if (__builtin_cpu_supports("sse4.1")) {
+            return SSE4;
+        }
+        return SCALAR;
+    }();
+    return support;
+#else
+    return SCALAR;
+#endif
+}
+
+void Octave::sample_batch(
+    std::span<const glm::vec2> in, std::span<f32> out) const {
+    this->sample_batch(Octave::batch_support(), in, out);
+}
+
+void Octave::sample_batch(
+    Batch batch,
+    std::span<const glm::vec2> in,
+    std::span<f32> out) const {
+    util::_assert(out.size() >= in.size());
+
+    // number of points done with SIMD, the rest are done one at a time
+    usize i = 0;
+
+#ifdef NOISE_X86
+    switch (batch) {
+        case AVX2:
+            i = octave_avx2(*this, &in[0], &out[0], in.size());
+            break;
+        case SSE4:
+            i = octave_sse4(*this, &in[0], &out[0], in.size());
+            break;
+        default:
+            break;
+    }
+#endif
+
+    for (; i < in.size(); i++) {
+        out[i] = this->sample(in[i]);
+    }
+}
+
 f32 Combined::sample(glm::vec2 i) const {
     return this->n->sample(glm::vec2(i.x + this->m->sample(i), i.y));
 }
+
+void Combined::sample_batch(
+    std::span<const glm::vec2> in, std::span<f32> out) const {
+    std::array<glm::vec2, BATCH_BLOCK> offset;
+    std::array<f32, BATCH_BLOCK> m;
+
+    for (usize b = 0; b < in.size(); b += BATCH_BLOCK) {
+        const usize count = std::min(BATCH_BLOCK, in.size() - b);
+        this->m->sample_batch(in.subspan(b, count), m);
+
+        for (usize i = 0; i < count; i++) {
+            offset[i] = glm::vec2(in[b + i].x + m[i], in[b + i].y);
+        }
+
+        this->n->sample_batch(
+            std::span(offset).first(count), out.subspan(b, count));
+    }
+}
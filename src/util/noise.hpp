@@ -1,21 +1,55 @@
 #ifndef UTIL_NOISE_HPP
 #define UTIL_NOISE_HPP
 
+#include "util/std.hpp"
 #include "util/types.hpp"
 #include "util/math.hpp"
+#include "util/assert.hpp"
 
 namespace util {
     struct Noise {
         virtual f32 sample(glm::vec2 i) const = 0;
+
+        // samples every point in in into out (which must be at least as
+        // large), by default one point at a time
+        virtual void sample_batch(
+            std::span<const glm::vec2> in, std::span<f32> out) const;
     };
 
     struct Octave : Noise {
+        // instruction sets batch sampling can use, the best one supported by
+        // the CPU is picked at runtime
+        enum Batch {
+            SCALAR = 0,
+            SSE4 = 1,
+            AVX2 = 2
+        };
+
         u64 seed;
         usize n;
         f32 o;
 
         Octave(u64 seed, usize n, f32 o) : seed(seed), n(n), o(o) {}
         f32 sample(glm::vec2 i) const override;
+
+        // results are bit-identical to sample() for every Batch
+        void sample_batch(
+            std::span<const glm::vec2> in,
+            std::span<f32> out) const override;
+
+        // sample_batch with a specific instruction set, must be supported
+        void sample_batch(
+            Batch batch,
+            std::span<const glm::vec2> in,
+            std::span<f32> out) const;
+
+        // best instruction set supported by this CPU
+        static Batch batch_support();
+
+        // z coordinate of octave j
+        inline f32 z(usize j) const {
+            return this->seed + j + (this->o * 32);
+        }
     };
 
     struct Combined : Noise {
@@ -23,6 +57,10 @@ namespace util {
 
         Combined(Noise &n, Noise &m) : n(&n), m(&m) {}
         f32 sample(glm::vec2 i) const override;
+
+        void sample_batch(
+            std::span<const glm::vec2> in,
+            std::span<f32> out) const override;
     };
 };
 
@@ -0,0 +1,243 @@
+#include "util/occlusion.hpp"
+
+// SSE2 is part of every x86-64 CPU, so there is nothing to detect at runtime
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define OCCLUSION_SSE
+#endif
+
+using namespace util;
+
+OcclusionBuffer::OcclusionBuffer(usize width, usize height)
+    : width(width),
+      height(height),
+      simd(OcclusionBuffer::simd_support()),
+      view_proj(1.0f),
+      depth(width * height, FAR),
+      triangles(0),
+      rasterized(0) {}
+
+bool OcclusionBuffer::simd_support() {
+#ifdef OCCLUSION_SSE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void OcclusionBuffer::clear(const glm::mat4 &view_proj) {
+    this->view_proj = view_proj;
+    this->triangles = 0;
+    this->rasterized = 0;
+    std::fill(this->depth.begin(), this->depth.end(), FAR);
+}
+
+void OcclusionBuffer::occluder(
+    const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+    this->triangles++;
+
+    std::array<glm::vec2, 3> p;
+    f32 z = -FAR;
+
+    usize i = 0;
+    for (const auto &v : { a, b, c }) {
+        const auto clip = this->view_proj * glm::vec4(v, 1.0f);
+        if (clip.w < NEAR_W) {
+            return;
+        }
+
+        const auto ndc = glm::vec3(clip) / clip.w;
+        p[i++] =
+            glm::vec2(
+                ((ndc.x * 0.5f) + 0.5f) * this->width,
+                ((ndc.y * 0.5f) + 0.5f) * this->height);
+        z = std::max(z, ndc.z);
+    }
+
+    // either winding, rasterize counter-clockwise
+    const f32 area =
+        ((p[1].x - p[0].x) * (p[2].y - p[0].y))
+            - ((p[2].x - p[0].x) * (p[1].y - p[0].y));
+
+    if (std::abs(area) < 1e-6f) {
+        return;
+    } else if (area < 0.0f) {
+        std::swap(p[1], p[2]);
+    }
+
+    const auto
+        min = glm::min(p[0], glm::min(p[1], p[2])),
+        max = glm::max(p[0], glm::max(p[1], p[2]));
+
+    const int
+        x_min = std::max(static_cast<int>(std::floor(min.x)), 0),
+        y_min = std::max(static_cast<int>(std::floor(min.y)), 0),
+        x_max =
+            std::min(
+                static_cast<int>(std::ceil(max.x)) - 1,
+                static_cast<int>(this->width) - 1),
+        y_max =
+            std::min(
+                static_cast<int>(std::ceil(max.y)) - 1,
+                static_cast<int>(this->height) - 1);
+
+    if (x_min > x_max || y_min > y_max) {
+        return;
+    }
+
+    this->rasterized++;
+    this->rasterize(p, z, x_min, x_max, y_min, y_max);
+}
+
+void OcclusionBuffer::rasterize(
+    const std::array<glm::vec2, 3> &p, f32 z,
+    int x_min, int x_max, int y_min, int y_max) {
+    // edge functions e(x, y) = ax + by + c, >= 0 inside, a pixel is entirely
+    // inside of an edge if e at its center is at least bias
+    std::array<f32, 3> a, b, c, bias;
+    for (usize i = 0; i < 3; i++) {
+        const auto &p0 = p[i], &p1 = p[(i + 1) % 3];
+        a[i] = p0.y - p1.y;
+        b[i] = p1.x - p0.x;
+        c[i] = (p0.x * p1.y) - (p0.y * p1.x);
+        bias[i] = 0.5f * (std::abs(a[i]) + std::abs(b[i]));
+    }
+
+    for (int y = y_min; y <= y_max; y++) {
+        const f32 py = static_cast<f32>(y) + 0.5f;
+
+        // e at pixel x is a[i] * px + r[i]
+        std::array<f32, 3> r;
+        for (usize i = 0; i < 3; i++) {
+            r[i] = ((b[i] * py) + c[i]) - bias[i];
+        }
+
+        f32 *row = &this->depth[y * this->width];
+        int x = x_min;
+
+#ifdef OCCLUSION_SSE
+        if (this->simd) {
+            const __m128
+                offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f),
+                zero = _mm_setzero_ps(),
+                vz = _mm_set1_ps(z),
+                a0 = _mm_set1_ps(a[0]), r0 = _mm_set1_ps(r[0]),
+                a1 = _mm_set1_ps(a[1]), r1 = _mm_set1_ps(r[1]),
+                a2 = _mm_set1_ps(a[2]), r2 = _mm_set1_ps(r[2]);
+
+            for (; x + 3 <= x_max; x += 4) {
+                const __m128 px =
+                    _mm_add_ps(_mm_set1_ps(static_cast<f32>(x)), offsets);
+                const __m128 inside =
+                    _mm_and_ps(
+                        _mm_cmpge_ps(
+                            _mm_add_ps(_mm_mul_ps(a0, px), r0), zero),
+                        _mm_and_ps(
+                            _mm_cmpge_ps(
+                                _mm_add_ps(_mm_mul_ps(a1, px), r1), zero),
+                            _mm_cmpge_ps(
+                                _mm_add_ps(_mm_mul_ps(a2, px), r2), zero)));
+
+                const __m128 d = _mm_loadu_ps(&row[x]);
+                _mm_storeu_ps(
+                    &row[x],
+                    _mm_or_ps(
+                        _mm_and_ps(inside, _mm_min_ps(d, vz)),
+                        _mm_andnot_ps(inside, d)));
+            }
+        }
+#endif
+
+        for (; x <= x_max; x++) {
+            const f32 px = static_cast<f32>(x) + 0.5f;
+
+            if ((a[0] * px) + r[0] >= 0.0f
+                    && (a[1] * px) + r[1] >= 0.0f
+                    && (a[2] * px) + r[2] >= 0.0f) {
+                row[x] = std::min(row[x], z);
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::occluder(const AABB &box, const glm::vec3 &position) {
+    for (int axis = 0; axis < 3; axis++) {
+        // face on this axis which faces position, if any
+        f32 plane;
+        if (position[axis] < box.min[axis]) {
+            plane = box.min[axis];
+        } else if (position[axis] > box.max[axis]) {
+            plane = box.max[axis];
+        } else {
+            continue;
+        }
+
+        const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        std::array<glm::vec3, 4> corners;
+        for (usize i = 0; i < 4; i++) {
+            auto &corner = corners[i];
+            corner[axis] = plane;
+            corner[u] = (i == 1 || i == 2) ? box.max[u] : box.min[u];
+            corner[v] = (i >= 2) ? box.max[v] : box.min[v];
+        }
+
+        this->occluder(corners[0], corners[1], corners[2]);
+        this->occluder(corners[0], corners[2], corners[3]);
+    }
+}
+
+bool OcclusionBuffer::occluded(const AABB &box) const {
+    auto min = glm::vec2(FAR), max = glm::vec2(-FAR);
+    f32 z = FAR;
+
+    for (usize i = 0; i < 8; i++) {
+        const auto corner =
+            glm::vec3(
+                (i & 1) ? box.max.x : box.min.x,
+                (i & 2) ? box.max.y : box.min.y,
+                (i & 4) ? box.max.z : box.min.z);
+
+        const auto clip = this->view_proj * glm::vec4(corner, 1.0f);
+        if (clip.w < NEAR_W) {
+            return false;
+        }
+
+        const auto ndc = glm::vec3(clip) / clip.w;
+        const auto p =
+            glm::vec2(
+                ((ndc.x * 0.5f) + 0.5f) * this->width,
+                ((ndc.y * 0.5f) + 0.5f) * this->height);
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+        z = std::min(z, ndc.z);
+    }
+
+    // only pixels on screen matter, entirely off screen is left to frustum
+    // culling
+    const int
+        x_min = std::max(static_cast<int>(std::floor(min.x)), 0),
+        y_min = std::max(static_cast<int>(std::floor(min.y)), 0),
+        x_max =
+            std::min(
+                static_cast<int>(std::ceil(max.x)) - 1,
+                static_cast<int>(this->width) - 1),
+        y_max =
+            std::min(
+                static_cast<int>(std::ceil(max.y)) - 1,
+                static_cast<int>(this->height) - 1);
+
+    if (x_min > x_max || y_min > y_max) {
+        return false;
+    }
+
+    for (int y = y_min; y <= y_max; y++) {
+        const f32 *row = &this->depth[y * this->width];
+        for (int x = x_min; x <= x_max; x++) {
+            if (row[x] >= z) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
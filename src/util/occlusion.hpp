@@ -0,0 +1,64 @@
+#ifndef UTIL_OCCLUSION_HPP
+#define UTIL_OCCLUSION_HPP
+
+#include "util/std.hpp"
+#include "util/types.hpp"
+#include "util/math.hpp"
+#include "util/aabb.hpp"
+
+namespace util {
+// low resolution software depth buffer for occlusion culling: occluder
+// triangles are rasterized into it on the CPU and boxes are then tested
+// against it
+// conservative: occluders only cover pixels they cover entirely, at the
+// depth of their farthest vertex, and a box is only occluded if every pixel
+// it touches is covered by something in front of all of it
+// deterministic, SIMD and scalar rasterization give bit-identical results
+struct OcclusionBuffer {
+    // depth of pixels no occluder covers
+    static constexpr f32 FAR = std::numeric_limits<f32>::max();
+
+    // clip space w below which vertices count as behind the camera
+    static constexpr f32 NEAR_W = 1e-4f;
+
+    usize width, height;
+
+    // rasterize 4 pixels at a time where supported
+    bool simd;
+
+    glm::mat4 view_proj;
+
+    // NDC depth of the nearest occluder over each pixel, row-major
+    std::vector<f32> depth;
+
+    // occluder triangles submitted/rasterized since clear()
+    usize triangles, rasterized;
+
+    explicit OcclusionBuffer(usize width = 256, usize height = 128);
+
+    // true if rasterization can use SIMD on this CPU
+    static bool simd_support();
+
+    // resets every pixel to FAR and sets the matrix transforming world space
+    // occluders and boxes into clip space
+    void clear(const glm::mat4 &view_proj);
+
+    // rasterizes a triangle (world space) as an occluder, either winding
+    // triangles crossing the near plane are skipped
+    void occluder(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+
+    // rasterizes the faces of box which face position as occluders
+    void occluder(const AABB &box, const glm::vec3 &position);
+
+    // true if box is certainly hidden behind occluders
+    bool occluded(const AABB &box) const;
+
+private:
+    // rasterizes rows [y_min, y_max] of a screen space triangle
+    void rasterize(
+        const std::array<glm::vec2, 3> &p, f32 z,
+        int x_min, int x_max, int y_min, int y_max);
+};
+}
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef UTIL_PALETTE_HPP
+#define UTIL_PALETTE_HPP
+
+#include "util/std.hpp"
+#include "util/types.hpp"
+#include "util/assert.hpp"
+
+namespace util {
+// fixed-size array of N elements of T stored as a palette of unique values
+// plus bit-packed indices into that palette
+// starts out uniform (single palette entry, zero bits per index) and widens
+// indices on demand as new unique values are written
+template <typename T, usize N>
+struct PaletteArray {
+    static_assert(N <= (1 << 16), "PaletteArray indices are at most 16 bits");
+
+    // size of equivalent flat T[N] array
+    static constexpr usize FLAT_BYTES = N * sizeof(T);
+
+    // unique values, indexed by packed indices
+    std::vector<T> palette;
+
+    // packed indices, always a power of two bits wide so that no index
+    // straddles a word boundary
+    std::vector<u64> words;
+    u8 bits;
+
+    PaletteArray() { this->fill(T(0)); }
+
+    inline T get(usize i) const {
+        if (this->bits == 0) {
+            return this->palette[0];
+        }
+
+        const usize b = i * this->bits;
+        return this->palette[
+            (this->words[b / 64] >> (b % 64)) & this->mask()];
+    }
+
+    inline void set(usize i, T value) {
+        // fast path, usually writing into a chunk of only one other value
+        if (this->bits == 0 && this->palette[0] == value) {
+            return;
+        }
+
+        this->set_index(i, this->index_of(value));
+    }
+
+    // set elements [begin, end) to value
+    inline void fill(usize begin, usize end, T value) {
+        if (this->bits == 0 && this->palette[0] == value) {
+            return;
+        } else if (begin == 0 && end == N) {
+            this->fill(value);
+            return;
+        }
+
+        const usize index = this->index_of(value);
+        for (usize i = begin; i < end; i++) {
+            this->set_index(i, index);
+        }
+    }
+
+    // true if value is (or at some point was) present
+    inline bool contains(T value) const {
+        return std::find(this->palette.begin(), this->palette.end(), value)
+            != this->palette.end();
+    }
+
+    // reset to a single value
+    inline void fill(T value) {
+        this->palette.clear();
+        this->palette.push_back(value);
+        this->words.clear();
+        this->words.shrink_to_fit();
+        this->bits = 0;
+    }
+
+    // true if every element has the same value
+    inline bool uniform() const {
+        return this->bits == 0;
+    }
+
+    // approximate heap + inline memory usage
+    inline usize bytes() const {
+        return sizeof(*this)
+            + (this->palette.capacity() * sizeof(T))
+            + (this->words.capacity() * sizeof(u64));
+    }
+
+private:
+    inline u64 mask() const {
+        return (u64(1) << this->bits) - 1;
+    }
+
+    inline void set_index(usize i, usize index) {
+        if (this->bits == 0) {
+            return;
+        }
+
+        const usize b = i * this->bits;
+        auto &word = this->words[b / 64];
+        word =
+            (word & ~(this->mask() << (b % 64)))
+            | (static_cast<u64>(index) << (b % 64));
+    }
+
+    // gets index of value in palette, adding it (and widening indices if
+    // needed) if not present
+    inline usize index_of(T value) {
+        for (usize i = 0; i < this->palette.size(); i++) {
+            if (this->palette[i] == value) {
+                return i;
+            }
+        }
+
+        this->palette.push_back(value);
+
+        if (this->palette.size() > (usize(1) << this->bits)) {
+            u8 bits = this->bits == 0 ? 1 : this->bits * 2;
+            while (this->palette.size() > (usize(1) << bits)) {
+                bits *= 2;
+            }
+            this->resize(bits);
+        }
+
+        return this->palette.size() - 1;
+    }
+
+    // repack indices at new bit width
+    void resize(u8 bits) {
+        util::_assert(bits <= 16, "PaletteArray overflow");
+
+        std::vector<u64> words((N * bits + 63) / 64, 0);
+
+        if (this->bits != 0) {
+            for (usize i = 0; i < N; i++) {
+                const usize
+                    b_old = i * this->bits,
+                    b_new = i * bits,
+                    index =
+                        (this->words[b_old / 64] >> (b_old % 64))
+                            & this->mask();
+                words[b_new / 64] |= static_cast<u64>(index) << (b_new % 64);
+            }
+        }
+
+        this->words = std::move(words);
+        this->bits = bits;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef UTIL_POOL_HPP
+#define UTIL_POOL_HPP
+
+#include <sys/mman.h>
+
+#include "util/std.hpp"
+#include "util/types.hpp"
+#include "util/assert.hpp"
+#include "util/log.hpp"
+
+namespace util {
+struct PoolStats {
+    // allocations served from the free list/allocations which needed a new
+    // slot (and possibly a new slab)
+    usize hits = 0, misses = 0;
+
+    // slabs allocated, objects currently handed out
+    usize slabs = 0, live = 0;
+
+    // bytes of all slabs
+    usize slab_bytes = 0;
+
+    // logs these stats as those of the pool called name
+    inline void debug_stats(const std::string &name) const {
+        util::log::out()
+            << name << " pool: "
+            << this->hits << " hits, "
+            << this->misses << " misses, "
+            << this->live << " live, "
+            << this->slabs << " slabs"
+            << util::log::end;
+    }
+};
+
+// slab allocator for objects of type T, freed objects go on a free list and
+// are handed back out before any new slots are used
+// if RECYCLE is set, freed objects are *not* destroyed and are instead reused
+// through T::recycle(args...) so that any resources they own are kept alive
+// NOTE: not thread safe
+template <typename T, bool RECYCLE = false>
+struct Pool {
+    static constexpr usize HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // unique_ptr deleter which returns objects to their pool
+    struct Deleter {
+        Pool *pool = nullptr;
+
+        inline void operator()(T *t) const {
+            this->pool->free(t);
+        }
+    };
+
+    using Ptr = std::unique_ptr<T, Deleter>;
+
+    PoolStats stats;
+
+    // slab_size: number of objects per slab
+    // huge_pages: round slabs up to and advise the kernel to back them with
+    // huge pages (where supported)
+    explicit Pool(usize slab_size = 64, bool huge_pages = false)
+        : slab_size(slab_size), huge_pages(huge_pages) {}
+
+    Pool(const Pool &other) = delete;
+    Pool(Pool &&other) = delete;
+    Pool &operator=(const Pool &other) = delete;
+    Pool &operator=(Pool &&other) = delete;
+
+    ~Pool() {
+        util::_assert(
+            this->stats.live == 0,
+            "Pool destroyed with live objects",
+            false);
+
+        if constexpr (RECYCLE) {
+            for (auto *t : this->free_list) {
+                t->~T();
+            }
+        }
+
+        for (auto *slab : this->slabs) {
+            std::free(slab);
+        }
+    }
+
+    template <typename ...Args>
+    T *alloc(Args&& ...args) {
+        this->stats.live++;
+
+        if (!this->free_list.empty()) {
+            this->stats.hits++;
+
+            T *t = this->free_list.back();
+            this->free_list.pop_back();
+
+            if constexpr (RECYCLE) {
+                t->recycle(std::forward<Args>(args)...);
+                return t;
+            } else {
+                return new (t) T(std::forward<Args>(args)...);
+            }
+        }
+
+        this->stats.misses++;
+
+        if (this->slab_used == this->slab_capacity) {
+            this->new_slab();
+        }
+
+        T *t = reinterpret_cast<T*>(this->slabs.back()) + this->slab_used++;
+        return new (t) T(std::forward<Args>(args)...);
+    }
+
+    template <typename ...Args>
+    inline Ptr make(Args&& ...args) {
+        return Ptr(this->alloc(std::forward<Args>(args)...), Deleter { this });
+    }
+
+    void free(T *t) {
+        if constexpr (!RECYCLE) {
+            t->~T();
+        }
+
+        this->free_list.push_back(t);
+        this->stats.live--;
+    }
+
+private:
+    usize slab_size;
+    bool huge_pages;
+
+    std::vector<u8*> slabs;
+    std::vector<T*> free_list;
+    usize slab_used = 0, slab_capacity = 0;
+
+    void new_slab() {
+        const usize align =
+            this->huge_pages ?
+                HUGE_PAGE_SIZE
+                : std::max<usize>(alignof(T), alignof(std::max_align_t));
+
+        // aligned_alloc requires a multiple of the alignment
+        const usize size =
+            ((this->slab_size * sizeof(T) + align - 1) / align) * align;
+
+        auto *slab = reinterpret_cast<u8*>(std::aligned_alloc(align, size));
+        util::_assert(slab, "Pool out of memory");
+
+#ifdef MADV_HUGEPAGE
+        if (this->huge_pages) {
+            madvise(slab, size, MADV_HUGEPAGE);
+        }
+#endif
+
+        this->slabs.push_back(slab);
+        this->slab_used = 0;
+        this->slab_capacity = size / sizeof(T);
+        this->stats.slabs++;
+        this->stats.slab_bytes += size;
+    }
+};
+}
+
+#endif
@@ -35,6 +35,8 @@
 #include <any>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <span>
 #include <random>
 
@@ -19,8 +19,13 @@
 #include "util/iterator.hpp"
 #include "util/assert.hpp"
 #include "util/aabb.hpp"
+#include "util/frustum.hpp"
+#include "util/occlusion.hpp"
 #include "util/ray.hpp"
 #include "util/arena.hpp"
+#include "util/palette.hpp"
+#include "util/pool.hpp"
+#include "util/jobs.hpp"
 #include "util/color.hpp"
 #include "util/noise.hpp"
 